@@ -0,0 +1,206 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+#include "CFR.h"
+
+// Benchmark harness behind the --bench mode of each program. Micro-benchmarks time one hot
+// function in ns per call; macro-benchmarks time whole training runs from a fixed seed and
+// report iterations and information-set visits per second. Results can be saved as a
+// baseline, one "name value unit" line each, and later runs compared against it.
+namespace bench {
+
+// Keep the compiler from discarding a value that is computed only to be timed
+template<class T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+    std::string name;
+    double value;
+    std::string unit;
+
+    // Rates are better higher, times per call lower
+    bool higherIsBetter() const {
+        return unit.size() >= 2 && unit.compare(unit.size() - 2, 2, "/s") == 0;
+    }
+};
+
+// Command line settings of a benchmark run
+struct Options {
+    bool enabled = false;
+    std::string baselinePath;
+    std::string savePath;
+    // Percent by which a result may be worse than its baseline before it is a regression
+    double tolerance = 10.0;
+    // Timing repeats; the best is kept
+    int repeats = 5;
+    // Multiplier on the iterations of every macro-benchmark
+    double scale = 1.0;
+    // Seed of every macro-benchmark's generators
+    uint64_t seed = 12345;
+};
+
+// Consume the benchmark argument at argv[i], if it is one:
+//   --bench [--baseline file] [--save-baseline file] [--tolerance percent] [--repeats R] [--bench-scale X]
+inline bool parseArgument(Options& options, int argc, char* argv[], int& i) {
+    std::string arg = argv[i];
+    if (arg == "--bench") {
+        options.enabled = true;
+    }
+    else if (arg == "--baseline" && i + 1 < argc) {
+        options.baselinePath = argv[++i];
+    }
+    else if (arg == "--save-baseline" && i + 1 < argc) {
+        options.savePath = argv[++i];
+    }
+    else if (arg == "--tolerance" && i + 1 < argc) {
+        options.tolerance = std::stod(argv[++i]);
+    }
+    else if (arg == "--repeats" && i + 1 < argc) {
+        options.repeats = std::max(1, std::stoi(argv[++i]));
+    }
+    else if (arg == "--bench-scale" && i + 1 < argc) {
+        options.scale = std::stod(argv[++i]);
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+class Suite {
+public:
+    Options options;
+    std::vector<Result> results;
+
+    explicit Suite(const Options& options) : options(options) {}
+
+    // Time f(i) for i in 0 .. calls - 1 and record the best ns per call over the repeats
+    template<class F>
+    void micro(const std::string& name, long calls, F f) {
+        double best = 1e300;
+        for (int r = 0; r < options.repeats; r++) {
+            auto start = std::chrono::steady_clock::now();
+            for (long i = 0; i < calls; i++) {
+                f(i);
+            }
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count() / calls);
+        }
+        add({name, best, "ns"});
+    }
+
+    // Time train(iterations), which trains a fresh trainer from the benchmark seed and returns
+    // its nodesTouched, and record the best iterations and nodes per second over the repeats
+    template<class F>
+    void macro(const std::string& name, long iterations, F train) {
+        iterations = std::max(1L, (long) (iterations * options.scale));
+        double best = 1e300;
+        uint64_t nodes = 0;
+        for (int r = 0; r < options.repeats; r++) {
+            cfr::seedGenerators(options.seed);
+            auto start = std::chrono::steady_clock::now();
+            nodes = train(iterations);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        cfr::seedGenerators(0);
+        add({name + ".iterations", iterations / best, "it/s"});
+        add({name + ".nodes", nodes / best, "nodes/s"});
+    }
+
+    void add(const Result& result) {
+        results.push_back(result);
+        std::cout << std::left << std::setw(40) << result.name << std::right << std::setw(14)
+                  << format(result.value) << " " << result.unit << std::endl;
+    }
+
+    // Compare against and save baselines as requested, returning the exit status: 1 if any
+    // result regressed past the tolerance or a file could not be read or written
+    int finish() const {
+        int status = 0;
+        if (!options.baselinePath.empty() && !report(options.baselinePath)) {
+            status = 1;
+        }
+        if (!options.savePath.empty() && !save(options.savePath)) {
+            status = 1;
+        }
+        return status;
+    }
+
+    bool save(const std::string& path) const {
+        std::ofstream out(path);
+        for (const Result& result : results) {
+            out << result.name << " " << std::setprecision(10) << result.value << " " << result.unit << "\n";
+        }
+        if (!out) {
+            std::cerr << "Could not write baseline " << path << "\n";
+            return false;
+        }
+        std::cout << "Wrote baseline " << path << "\n";
+        return true;
+    }
+
+    // Print each result against its baseline, returning false on any regression
+    bool report(const std::string& path) const {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Could not read baseline " << path << "\n";
+            return false;
+        }
+        std::unordered_map<std::string, Result> baseline;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            Result result;
+            if (fields >> result.name >> result.value >> result.unit) {
+                baseline[result.name] = result;
+            }
+        }
+
+        std::cout << "\n" << std::left << std::setw(40) << "Benchmark" << std::right << std::setw(14) << "Baseline"
+                  << std::setw(14) << "Current" << std::setw(10) << "Gain" << "\n";
+        int regressions = 0;
+        for (const Result& result : results) {
+            std::cout << std::left << std::setw(40) << result.name << std::right;
+            auto it = baseline.find(result.name);
+            if (it == baseline.end() || it->second.unit != result.unit || it->second.value <= 0) {
+                std::cout << std::setw(14) << "-" << std::setw(14) << format(result.value) << "       new\n";
+                continue;
+            }
+            // Percent change, positive when the result improved
+            double change = 100.0 * (result.value - it->second.value) / it->second.value;
+            if (!result.higherIsBetter()) change = -change;
+            std::ostringstream gain;
+            gain << std::showpos << std::fixed << std::setprecision(1) << change << "%";
+            std::cout << std::setw(14) << format(it->second.value) << std::setw(14) << format(result.value)
+                      << std::setw(10) << gain.str();
+            if (change < -options.tolerance) {
+                std::cout << "  REGRESSION";
+                regressions++;
+            }
+            std::cout << "\n";
+        }
+        std::cout << regressions << " regressions beyond " << options.tolerance << "% against " << path << "\n";
+        return regressions == 0;
+    }
+
+    static std::string format(double value) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(value < 100 ? 3 : 0) << value;
+        return out.str();
+    }
+};
+
+}
@@ -0,0 +1,722 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <concepts>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "Telemetry.h"
+#include "Checkpoint.h"
+#include "Policy.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CFR_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define CFR_X86_SIMD 0
+#endif
+
+// Game-independent pieces shared by the Dudo, Dudo3 and Liar Die trainers: regret matching
+// (with AVX2/AVX-512 kernels picked at runtime), average strategies, the iteration weighting
+// schemes, the flat node store with its checkpoints and policy tables, and an
+// external-sampling MCCFR driver for any type modelling the Game concept.
+// Requires C++20.
+namespace cfr {
+
+// Regret matching fused with the average-strategy update: strategy is the normalized positive
+// part of regretSum, uniform if none, and weight times it is added to strategySum unless that
+// is null. Scalar version; the double overloads below pick a vector kernel at runtime.
+template<class Value, class Out, class Sum>
+inline void regretMatchScalar(const Value* regretSum, Out* strategy, Sum* strategySum, int n, double weight) {
+    double normalizingSum = 0.0;
+
+    for (int i = 0; i < n; i++) {
+        strategy[i] = std::max(regretSum[i], Value(0));
+        normalizingSum += strategy[i];
+    }
+
+    if (normalizingSum > 0) {
+        for (int i = 0; i < n; i++) {
+            strategy[i] /= normalizingSum;
+        }
+    }
+    else {
+        for (int i = 0; i < n; i++) {
+            strategy[i] = 1.0 / n;
+        }
+    }
+
+    if (strategySum != nullptr) {
+        for (int i = 0; i < n; i++) {
+            strategySum[i] += weight * strategy[i];
+        }
+    }
+}
+
+// Regret-matching strategy for n actions: positive regrets normalized, uniform if none
+template<class Value, class Out>
+inline void regretMatch(const Value* regretSum, Out* strategy, int n) {
+    regretMatchScalar(regretSum, strategy, static_cast<Value*>(nullptr), n, 0.0);
+}
+
+// Regret matching that also adds weight times the strategy to strategySum
+template<class Value, class Out>
+inline void regretMatchAccumulate(const Value* regretSum, Out* strategy, Value* strategySum, int n, double weight) {
+    regretMatchScalar(regretSum, strategy, strategySum, n, weight);
+}
+
+// Vector instruction sets the double kernels can use, best first
+enum class SimdLevel {
+    AVX512,
+    AVX2,
+    Scalar
+};
+
+inline const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512: return "avx512";
+        case SimdLevel::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+// Best level this CPU supports, capped by the CFR_SIMD environment variable
+// (avx512, avx2 or scalar) so runs can be compared on one machine
+inline SimdLevel detectSimdLevel() {
+    SimdLevel level = SimdLevel::Scalar;
+#if CFR_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) level = SimdLevel::AVX512;
+    else if (__builtin_cpu_supports("avx2")) level = SimdLevel::AVX2;
+#endif
+    const char* cap = std::getenv("CFR_SIMD");
+    if (cap != nullptr) {
+        for (SimdLevel capped : {SimdLevel::AVX2, SimdLevel::Scalar}) {
+            if (std::strcmp(cap, simdLevelName(capped)) == 0 && capped > level) {
+                level = capped;
+            }
+        }
+    }
+    return level;
+}
+
+inline const SimdLevel simdLevel = detectSimdLevel();
+
+#if CFR_X86_SIMD
+// Four doubles per register. The second pass clamps regretSum again rather than reloading
+// strategy, since a masked store followed by a load of the same lanes defeats store
+// forwarding. The last partial group of actions goes through a lane mask, so nothing is
+// read or written past the node.
+__attribute__((target("avx2")))
+inline void regretMatchAVX2(const double* regretSum, double* strategy, double* strategySum, int n, double weight) {
+    static const int64_t laneMasks[8] = {-1, -1, -1, -1, 0, 0, 0, 0};
+    const __m256d zero = _mm256_setzero_pd();
+    const int full = n & ~3;
+    const __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(laneMasks + 4 - (n - full)));
+    __m256d total = zero;
+
+    for (int i = 0; i < full; i += 4) {
+        total = _mm256_add_pd(total, _mm256_max_pd(_mm256_loadu_pd(regretSum + i), zero));
+    }
+    if (full < n) {
+        total = _mm256_add_pd(total, _mm256_max_pd(_mm256_maskload_pd(regretSum + full, tail), zero));
+    }
+    __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(total), _mm256_extractf128_pd(total, 1));
+    double normalizingSum = _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+
+    const __m256d divisor = _mm256_set1_pd(normalizingSum);
+    const __m256d uniform = _mm256_set1_pd(1.0 / n);
+    const __m256d scale = _mm256_set1_pd(weight);
+    const bool normalize = normalizingSum > 0;
+
+    for (int i = 0; i < full; i += 4) {
+        __m256d prob = normalize ? _mm256_div_pd(_mm256_max_pd(_mm256_loadu_pd(regretSum + i), zero), divisor) : uniform;
+        _mm256_storeu_pd(strategy + i, prob);
+        if (strategySum != nullptr) {
+            _mm256_storeu_pd(strategySum + i, _mm256_add_pd(_mm256_loadu_pd(strategySum + i), _mm256_mul_pd(scale, prob)));
+        }
+    }
+    if (full < n) {
+        __m256d prob = normalize ? _mm256_div_pd(_mm256_max_pd(_mm256_maskload_pd(regretSum + full, tail), zero), divisor) : uniform;
+        _mm256_maskstore_pd(strategy + full, tail, prob);
+        if (strategySum != nullptr) {
+            __m256d sum = _mm256_add_pd(_mm256_maskload_pd(strategySum + full, tail), _mm256_mul_pd(scale, prob));
+            _mm256_maskstore_pd(strategySum + full, tail, sum);
+        }
+    }
+}
+
+// Eight doubles per register, with the partial group handled by a k-mask. GCC 12's own
+// AVX-512 headers trip -Wmaybe-uninitialized on their undefined-vector placeholders.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f")))
+inline void regretMatchAVX512(const double* regretSum, double* strategy, double* strategySum, int n, double weight) {
+    const __m512d zero = _mm512_setzero_pd();
+    __m512d total = zero;
+
+    for (int i = 0; i < n; i += 8) {
+        __mmask8 mask = (n - i >= 8) ? 0xFF : (__mmask8) ((1u << (n - i)) - 1);
+        total = _mm512_add_pd(total, _mm512_max_pd(_mm512_maskz_loadu_pd(mask, regretSum + i), zero));
+    }
+    double normalizingSum = _mm512_reduce_add_pd(total);
+
+    const __m512d divisor = _mm512_set1_pd(normalizingSum);
+    const __m512d uniform = _mm512_set1_pd(1.0 / n);
+    const __m512d scale = _mm512_set1_pd(weight);
+    const bool normalize = normalizingSum > 0;
+
+    for (int i = 0; i < n; i += 8) {
+        __mmask8 mask = (n - i >= 8) ? 0xFF : (__mmask8) ((1u << (n - i)) - 1);
+        __m512d prob = normalize ? _mm512_div_pd(_mm512_max_pd(_mm512_maskz_loadu_pd(mask, regretSum + i), zero), divisor) : uniform;
+        _mm512_mask_storeu_pd(strategy + i, mask, prob);
+        if (strategySum != nullptr) {
+            __m512d sum = _mm512_add_pd(_mm512_maskz_loadu_pd(mask, strategySum + i), _mm512_mul_pd(scale, prob));
+            _mm512_mask_storeu_pd(strategySum + i, mask, sum);
+        }
+    }
+}
+#pragma GCC diagnostic pop
+#endif
+
+// Double-precision kernel at the given level, falling back to scalar if it is not compiled in
+inline void regretMatchAt(SimdLevel level, const double* regretSum, double* strategy, double* strategySum,
+                          int n, double weight) {
+#if CFR_X86_SIMD
+    switch (level) {
+        case SimdLevel::AVX512:
+            regretMatchAVX512(regretSum, strategy, strategySum, n, weight);
+            return;
+        case SimdLevel::AVX2:
+            regretMatchAVX2(regretSum, strategy, strategySum, n, weight);
+            return;
+        default:
+            break;
+    }
+#endif
+    regretMatchScalar(regretSum, strategy, strategySum, n, weight);
+}
+
+// Level used for an n-action node. Below four actions the scalar loops beat the mask setup,
+// and AVX-512 only overtakes AVX2 once a node spans several of its registers.
+inline SimdLevel simdLevelFor(int n) {
+    if (n < 4) return SimdLevel::Scalar;
+    if (simdLevel == SimdLevel::AVX512 && n < 64) return SimdLevel::AVX2;
+    return simdLevel;
+}
+
+inline void regretMatch(const double* regretSum, double* strategy, int n) {
+    regretMatchAt(simdLevelFor(n), regretSum, strategy, nullptr, n, 0.0);
+}
+
+inline void regretMatchAccumulate(const double* regretSum, double* strategy, double* strategySum, int n, double weight) {
+    regretMatchAt(simdLevelFor(n), regretSum, strategy, strategySum, n, weight);
+}
+
+// Average strategy over training: strategySum normalized, uniform if never reached
+template<class Value, class Out>
+inline void averageStrategy(const Value* strategySum, Out* avg, int n) {
+    double normalizingSum = 0.0;
+
+    for (int i = 0; i < n; i++) {
+        normalizingSum += strategySum[i];
+    }
+    for (int i = 0; i < n; i++) {
+        if (normalizingSum > 0) {
+            avg[i] = strategySum[i] / normalizingSum;
+        }
+        else {
+            avg[i] = 1.0 / n;
+        }
+    }
+}
+
+template<class Value>
+inline std::vector<double> averageStrategy(const Value* strategySum, int n) {
+    std::vector<double> avg(n);
+    averageStrategy(strategySum, avg.data(), n);
+    return avg;
+}
+
+// Fixed-point number stored as Int with FRAC_BITS fraction bits, for compressed regret and
+// strategy tables. Arithmetic goes through double and saturates at the range of Int instead
+// of wrapping. Regret matching and average strategies only depend on the ratios within a
+// node, so a node nearing the limit is halved by rescale; that also discounts its history,
+// like the update rules do.
+template<class Int, int FRAC_BITS>
+class Scaled {
+public:
+    static_assert(std::is_integral_v<Int> && std::is_signed_v<Int>, "Scaled stores a signed integer");
+    static constexpr double ONE = double(1LL << FRAC_BITS);
+    static constexpr double LIMIT = double(std::numeric_limits<Int>::max());
+
+    Int raw = 0;
+
+    Scaled() = default;
+    Scaled(double value) : raw(quantize(value)) {}
+
+    // Round to nearest by offsetting before the truncating conversion; std::nearbyint is a
+    // library call without SSE4.1
+    static Int quantize(double value) {
+        double scaled = std::clamp(value * ONE, -LIMIT, LIMIT);
+        return (Int) (scaled + ((scaled >= 0) ? 0.5 : -0.5));
+    }
+
+    operator double() const {
+        return raw / ONE;
+    }
+
+    Scaled& operator+=(double value) { raw = quantize(double(*this) + value); return *this; }
+    Scaled& operator-=(double value) { raw = quantize(double(*this) - value); return *this; }
+    Scaled& operator*=(double value) { raw = quantize(double(*this) * value); return *this; }
+    Scaled& operator/=(double value) { raw = quantize(double(*this) / value); return *this; }
+};
+
+// Table value types selectable from the command line
+using Int32Value = Scaled<int32_t, 16>;
+using Int16Value = Scaled<int16_t, 10>;
+
+template<class Value>
+inline const char* storageName() {
+    if constexpr (std::is_same_v<Value, double>) return "float64";
+    else if constexpr (std::is_same_v<Value, float>) return "float32";
+    else if constexpr (std::is_same_v<Value, Int32Value>) return "int32";
+    else return "int16";
+}
+
+// Floating-point tables never need rescaling
+template<class Value>
+inline void rescale(Value*, size_t) {}
+
+// Halve n fixed-point values of one node if any has passed half the range, leaving headroom
+// for the updates before the next check
+template<class Int, int FRAC_BITS>
+inline void rescale(Scaled<Int, FRAC_BITS>* values, size_t n) {
+    Int threshold = std::numeric_limits<Int>::max() / 2;
+    for (size_t i = 0; i < n; i++) {
+        if (values[i].raw > threshold || values[i].raw < -threshold) {
+            for (size_t j = 0; j < n; j++) {
+                values[j].raw /= 2;
+            }
+            return;
+        }
+    }
+}
+
+// Index of an action drawn from the distribution prob over n actions
+template<class Generator>
+inline int sampleAction(const double* prob, int n, Generator& gen) {
+    double x = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+    for (int a = 0; a < n - 1; a++) {
+        x -= prob[a];
+        if (x < 0) return a;
+    }
+    return n - 1;
+}
+
+// Seed for makeStreamKey, 0 to draw every key from the system entropy source
+inline uint64_t generatorSeed = 0;
+// Stream keys made since the seed was set
+inline uint64_t generatorsMade = 0;
+
+// Make the stream keys that follow repeatable: the nth one made is derived from (seed, n),
+// so runs with the same seed and settings train identically. Seed 0 restores random keys.
+inline void seedGenerators(uint64_t seed) {
+    generatorSeed = seed;
+    generatorsMade = 0;
+}
+
+// Counter-based generator (Philox4x32-10). Output n of stream s under key k is a pure
+// function of (k, s, n): a stream can start at any position without drawing the ones before
+// it, and streams with different numbers are independent. Trainers number their streams by
+// deal, so any range of deals draws the same dice on any thread or in any process.
+class Philox {
+public:
+    using result_type = uint32_t;
+
+    Philox(uint64_t key, uint64_t stream, uint64_t position = 0) : key(key), stream(stream) {
+        seek(position);
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return 0xFFFFFFFFu;
+    }
+
+    result_type operator()() {
+        if (index == 4) {
+            generate(++block);
+            index = 0;
+        }
+        return output[index++];
+    }
+
+    // Jump to output position of the stream
+    void seek(uint64_t position) {
+        block = position / 4;
+        index = position % 4;
+        generate(block);
+    }
+
+    // Uniform integer in [0, n) (multiply-shift with rejection of the biased low products)
+    uint32_t below(uint32_t n) {
+        uint64_t product = (uint64_t) (*this)() * n;
+        if ((uint32_t) product < n) {
+            uint32_t threshold = -n % n;
+            while ((uint32_t) product < threshold) {
+                product = (uint64_t) (*this)() * n;
+            }
+        }
+        return product >> 32;
+    }
+
+private:
+    uint64_t key;
+    uint64_t stream;
+    uint64_t block = 0;
+    int index = 0;
+    uint32_t output[4];
+
+    // Encrypt the counter (block, stream) under key into the next four outputs
+    void generate(uint64_t counter) {
+        uint32_t c0 = (uint32_t) counter, c1 = (uint32_t) (counter >> 32);
+        uint32_t c2 = (uint32_t) stream, c3 = (uint32_t) (stream >> 32);
+        uint32_t k0 = (uint32_t) key, k1 = (uint32_t) (key >> 32);
+        for (int round = 0; round < 10; round++) {
+            uint64_t p0 = (uint64_t) 0xD2511F53u * c0;
+            uint64_t p1 = (uint64_t) 0xCD9E8D57u * c2;
+            uint32_t n0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+            uint32_t n2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+            c1 = (uint32_t) p1;
+            c3 = (uint32_t) p0;
+            c0 = n0;
+            c2 = n2;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        output[0] = c0;
+        output[1] = c1;
+        output[2] = c2;
+        output[3] = c3;
+    }
+};
+
+// Key for a training run's Philox streams, drawn from the system entropy source or derived
+// from (generatorSeed, keys made so far)
+inline uint64_t makeStreamKey() {
+    if (generatorSeed != 0) {
+        // splitmix64 finalizer, so nearby seeds give unrelated keys
+        uint64_t z = generatorSeed + 0x9E3779B97F4A7C15ULL * ++generatorsMade;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    std::random_device rd;
+    return ((uint64_t) rd() << 32) | rd();
+}
+
+// How accumulated regrets and strategy sums are weighted across iterations
+enum class UpdateRule {
+    Vanilla,    // plain regret matching, strategySum reset partway through training
+    CFRPlus,    // regrets floored at zero, average strategy weighted by iteration
+    Linear,     // regrets and average strategy weighted by iteration
+    Discounted  // DCFR: positive regrets, negative regrets and strategySum discounted by alpha, beta, gamma
+};
+
+// Factors applied to positive regrets, negative regrets and strategy sums after an iteration
+struct UpdateScales {
+    double positive = 1.0;
+    double negative = 1.0;
+    double strategy = 1.0;
+};
+
+// Scales for the end of iteration t (starting at 1). Returns false if rule leaves the sums
+// alone. Scaling the sums by t / (t + 1) every iteration is the same as weighting iteration t
+// by t.
+inline bool updateRuleScales(UpdateRule rule, double alpha, double beta, double gamma, int t, UpdateScales& scales) {
+    scales = UpdateScales{1.0, 1.0, t / (t + 1.0)};
+
+    switch (rule) {
+        case UpdateRule::Vanilla:
+            return false;
+        case UpdateRule::CFRPlus:
+            scales.negative = 0.0;
+            break;
+        case UpdateRule::Linear:
+            scales.positive = scales.negative = t / (t + 1.0);
+            break;
+        case UpdateRule::Discounted: {
+            double ta = std::pow(t, alpha);
+            double tb = std::pow(t, beta);
+            scales.positive = ta / (ta + 1.0);
+            scales.negative = tb / (tb + 1.0);
+            scales.strategy = std::pow(t / (t + 1.0), gamma);
+            break;
+        }
+    }
+    return true;
+}
+
+// Apply scales to n regret and strategy sums
+template<class Value>
+inline void discount(const UpdateScales& scales, Value* regretSum, Value* strategySum, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        regretSum[i] *= (regretSum[i] > 0) ? scales.positive : scales.negative;
+        strategySum[i] *= scales.strategy;
+    }
+}
+
+// Flat store of per-action values shared by the trainers. Node i, keyed keys[i], owns entries
+// offset[i] .. offset[i + 1] - 1 of regretSum and strategySum, one per legal action. Nodes
+// are checkpointed and exported in the order they were added, so a trainer that adds them in
+// a fixed order can resume from the checkpoints of an earlier run.
+template<class Value = double>
+class NodeStore {
+public:
+    std::vector<uint64_t> keys;
+    std::vector<int> offset{0};
+    std::vector<Value> regretSum;
+    std::vector<Value> strategySum;
+
+    // Append a node of numActions zeroed values and return its index. Pointers into the sums
+    // don't survive this.
+    int addNode(uint64_t key, int numActions) {
+        keys.push_back(key);
+        offset.push_back(offset.back() + numActions);
+        regretSum.resize(offset.back(), Value(0));
+        strategySum.resize(offset.back(), Value(0));
+        return keys.size() - 1;
+    }
+
+    int numNodes() const {
+        return keys.size();
+    }
+
+    void resetStrategySums() {
+        std::fill(strategySum.begin(), strategySum.end(), Value(0));
+    }
+
+    // Halve the fixed-point nodes nearing their range; a no-op for floating-point values
+    void rescaleSums() {
+        if constexpr (!std::is_floating_point_v<Value>) {
+            for (int i = 0; i < numNodes(); i++) {
+                rescale(&regretSum[offset[i]], offset[i + 1] - offset[i]);
+                rescale(&strategySum[offset[i]], offset[i + 1] - offset[i]);
+            }
+        }
+    }
+
+    // Bytes used by the keys, offsets and sums
+    size_t storeBytes() const {
+        return keys.size() * sizeof(uint64_t) + offset.size() * sizeof(int)
+               + (regretSum.size() + strategySum.size()) * sizeof(Value);
+    }
+
+    // Save the sums and iteration count to a binary checkpoint for game, widening them to
+    // double unless they already are
+    bool saveCheckpoint(const std::string& path, const std::string& game, int iteration) const {
+        std::vector<uint64_t> offsets(offset.begin(), offset.end());
+        if constexpr (std::is_same_v<Value, double>) {
+            return ::saveCheckpoint(path, game, iteration, keys, offsets, regretSum.data(), strategySum.data());
+        }
+        else {
+            std::vector<double> regrets(regretSum.begin(), regretSum.end());
+            std::vector<double> strategies(strategySum.begin(), strategySum.end());
+            return ::saveCheckpoint(path, game, iteration, keys, offsets, regrets.data(), strategies.data());
+        }
+    }
+
+    // Write the average strategies as a policy table keyed like the checkpoints
+    bool exportPolicy(const std::string& path, const std::string& game) const {
+        std::vector<uint64_t> offsets(offset.begin(), offset.end());
+        if constexpr (std::is_same_v<Value, double>) {
+            return ::savePolicy(path, game, keys, offsets, strategySum.data());
+        }
+        else {
+            std::vector<double> strategies(strategySum.begin(), strategySum.end());
+            return ::savePolicy(path, game, keys, offsets, strategies.data());
+        }
+    }
+
+    // Load the sums of a checkpoint for game with the same nodes, and its iteration count
+    bool loadCheckpoint(const std::string& path, const std::string& game, int& iteration) {
+        MappedCheckpoint checkpoint;
+        if (!checkpoint.open(path, game)) {
+            return false;
+        }
+        const CheckpointHeader& header = checkpoint.header();
+        bool match = header.numNodes == keys.size() && header.numValues == regretSum.size();
+        for (size_t i = 0; match && i <= keys.size(); i++) {
+            match = (i == keys.size() || checkpoint.keys()[i] == keys[i])
+                    && checkpoint.offsets()[i] == (uint64_t) offset[i];
+        }
+        if (!match) {
+            std::cerr << "Checkpoint " << path << " does not match the " << game << " nodes\n";
+            return false;
+        }
+        std::copy(checkpoint.regretSum(), checkpoint.regretSum() + regretSum.size(), regretSum.begin());
+        std::copy(checkpoint.strategySum(), checkpoint.strategySum() + strategySum.size(), strategySum.begin());
+        iteration = header.iteration;
+        return true;
+    }
+};
+
+// A two-player zero-sum game for the generic drivers. States are values; play and
+// sampleChance return successors. Information set keys must be unique per (player to act,
+// what that player knows), and numActions must be the same for every state in one.
+template<class G>
+concept Game = requires(const G& game, const typename G::State& state, int action, int player, Philox& gen) {
+    typename G::State;
+    { game.root() } -> std::same_as<typename G::State>;
+    { game.isTerminal(state) } -> std::convertible_to<bool>;
+    { game.utility(state, player) } -> std::convertible_to<double>;
+    { game.isChance(state) } -> std::convertible_to<bool>;
+    { game.sampleChance(state, gen) } -> std::same_as<typename G::State>;
+    { game.player(state) } -> std::convertible_to<int>;
+    { game.numActions(state) } -> std::convertible_to<int>;
+    { game.infoSetKey(state) } -> std::convertible_to<uint64_t>;
+    { game.play(state, action) } -> std::same_as<typename G::State>;
+};
+
+// External-sampling MCCFR for any Game. Chance and opponent actions are sampled, every
+// traverser action is walked. Only the information sets visited are stored, as NodeStore
+// nodes of Value (double, float or a Scaled integer) in the order they were first visited,
+// addressed through a hash map from information set key to offset.
+template<Game G, class Value = double>
+class ExternalSamplingTrainer : public NodeStore<Value> {
+public:
+    using State = typename G::State;
+    using NodeStore<Value>::regretSum;
+    using NodeStore<Value>::strategySum;
+
+    G game;
+
+    // Infoset key -> first entry of its per-action values in regretSum/strategySum
+    std::unordered_map<uint64_t, uint32_t> offsetOf;
+    // Decision nodes visited by traverse, for benchmarks
+    uint64_t nodesTouched = 0;
+
+    // Information sets with up to MAX_ACTIONS actions keep their strategy and utilities on
+    // the stack; larger ones allocate
+    static constexpr int MAX_ACTIONS = 64;
+
+    explicit ExternalSamplingTrainer(G game = G()) : game(std::move(game)) {}
+
+    // Offset of an information set's values, allocating them on the first visit
+    uint32_t getOffset(uint64_t infoSetNum, int numActions) {
+        auto [it, inserted] = offsetOf.try_emplace(infoSetNum, (uint32_t) regretSum.size());
+        CFR_TELEMETRY_LOOKUP(inserted);
+        if (inserted) {
+            this->addNode(infoSetNum, numActions);
+        }
+        return it->second;
+    }
+
+    // Expected utility of state, depth decisions below the root, for traverser. Values are
+    // addressed by offset because visiting a new child can grow the arrays.
+    double traverse(const State& state, int traverser, Philox& gen, int depth = 0) {
+        if (game.isTerminal(state)) {
+            CFR_TELEMETRY_TERMINAL(1);
+            return game.utility(state, traverser);
+        }
+        if (game.isChance(state)) {
+            return traverse(game.sampleChance(state, gen), traverser, gen, depth);
+        }
+
+        nodesTouched++;
+        CFR_TELEMETRY_VISIT(depth, 1);
+        int player = game.player(state);
+        int n = game.numActions(state);
+        uint32_t offset = getOffset(game.infoSetKey(state), n);
+        double local[2 * MAX_ACTIONS];
+        std::vector<double> heap;
+        double* strategy = local;
+        if (n > MAX_ACTIONS) {
+            heap.resize(2 * n);
+            strategy = heap.data();
+        }
+        double* util = strategy + n;
+        regretMatch(&regretSum[offset], strategy, n);
+
+        if (player != traverser) {
+            for (int a = 0; a < n; a++) {
+                strategySum[offset + a] += strategy[a];
+            }
+            rescale(&strategySum[offset], n);
+            return traverse(game.play(state, sampleAction(strategy, n, gen)), traverser, gen, depth + 1);
+        }
+
+        double nodeUtil = 0.0;
+        for (int a = 0; a < n; a++) {
+            util[a] = traverse(game.play(state, a), traverser, gen, depth + 1);
+            nodeUtil += strategy[a] * util[a];
+        }
+        for (int a = 0; a < n; a++) {
+            regretSum[offset + a] += util[a] - nodeUtil;
+        }
+        rescale(&regretSum[offset], n);
+        return nodeUtil;
+    }
+
+    // Average strategy at an information set, uniform if it was never visited
+    std::vector<double> getAverageStrategy(uint64_t infoSetNum, int numActions) const {
+        auto it = offsetOf.find(infoSetNum);
+        if (it == offsetOf.end()) {
+            return std::vector<double>(numActions, 1.0 / numActions);
+        }
+        return averageStrategy(&strategySum[it->second], numActions);
+    }
+
+    // Bytes used by the node store, counting hash table buckets and entries
+    size_t memoryUsage() const {
+        return this->storeBytes()
+               + offsetOf.bucket_count() * sizeof(void*)
+               + offsetOf.size() * (sizeof(std::pair<uint64_t, uint32_t>) + sizeof(void*));
+    }
+
+    // Run iterations of one traversal per player, resetting strategySum after 20% of them.
+    // Iteration i draws its chance and opponent samples from Philox stream i. Returns the
+    // average utility of player 0. Progress goes to telemetry, and to stdout only every
+    // printEvery iterations if that is positive.
+    double train(int iterations, int printEvery = 0) {
+        uint64_t key = makeStreamKey();
+        double util = 0.0;
+        int resetIndex = iterations / 5;
+
+        for (int i = 0; i < iterations; i++) {
+            if (i == resetIndex) {
+                CFR_TELEMETRY_PHASE(Reset);
+                this->resetStrategySums();
+            }
+            CFR_TELEMETRY_PHASE(Traverse);
+            Philox gen(key, i);
+            for (int traverser = 0; traverser < 2; traverser++) {
+                double value = traverse(game.root(), traverser, gen);
+                if (traverser == 0) {
+                    util += value;
+                }
+            }
+            CFR_TELEMETRY_TICK(i + 1, memoryUsage());
+            if (printEvery > 0 && (i + 1) % printEvery == 0) {
+                std::cout << "Iteration: " << i + 1 << "\n";
+                std::cout << "Average game value: " << util / (i + 1) << "\n";
+            }
+        }
+        CFR_TELEMETRY_FINISH(iterations, memoryUsage());
+        return util / iterations;
+    }
+};
+
+}
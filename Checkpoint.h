@@ -0,0 +1,167 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Versioned binary checkpoint of per-node regretSum/strategySum tables.
+//
+// File layout (native byte order, every section 8-byte aligned):
+//   CheckpointHeader
+//   uint64_t keys[numNodes]           integer information set key of each node
+//   uint64_t offsets[numNodes + 1]    node i owns values offsets[i] .. offsets[i + 1] - 1
+//   double   regretSum[numValues]
+//   double   strategySum[numValues]
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    char game[16];
+    uint64_t iteration;
+    uint64_t numNodes;
+    uint64_t numValues;
+};
+
+static const char CHECKPOINT_MAGIC[8] = {'C', 'F', 'R', 'C', 'K', 'P', 'T', '\0'};
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+// Write a checkpoint. regretSum and strategySum hold offsets.back() values each.
+inline bool saveCheckpoint(const std::string& path, const std::string& game, uint64_t iteration,
+                           const std::vector<uint64_t>& keys, const std::vector<uint64_t>& offsets,
+                           const double* regretSum, const double* strategySum) {
+    CheckpointHeader header = {};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.headerSize = sizeof(CheckpointHeader);
+    std::strncpy(header.game, game.c_str(), sizeof(header.game) - 1);
+    header.iteration = iteration;
+    header.numNodes = keys.size();
+    header.numValues = offsets.back();
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(regretSum), header.numValues * sizeof(double));
+    out.write(reinterpret_cast<const char*>(strategySum), header.numValues * sizeof(double));
+    if (!out) {
+        std::cerr << "Could not write checkpoint " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Read-only memory mapping of a whole file. Pages are only faulted in as they are read, so
+// even large tables open in microseconds.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (bytes != nullptr) {
+            munmap(bytes, length);
+        }
+    }
+
+    // Map path, reporting failures under the given description ("checkpoint", "policy")
+    bool open(const std::string& path, const char* what) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Could not open " << what << " " << path << "\n";
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            std::cerr << "Could not read " << what << " " << path << "\n";
+            ::close(fd);
+            return false;
+        }
+        length = st.st_size;
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            std::cerr << "Could not map " << what << " " << path << "\n";
+            return false;
+        }
+        bytes = static_cast<char*>(mapped);
+        return true;
+    }
+
+    const char* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    char* bytes = nullptr;
+    size_t length = 0;
+};
+
+// Read-only memory mapping of a checkpoint file
+class MappedCheckpoint {
+public:
+    // Map path and check that it is a checkpoint of this version for game
+    bool open(const std::string& path, const std::string& game) {
+        if (!file.open(path, "checkpoint")) {
+            return false;
+        }
+        if (file.size() < sizeof(CheckpointHeader)) {
+            std::cerr << "Checkpoint " << path << " is truncated\n";
+            return false;
+        }
+
+        const CheckpointHeader& h = header();
+        if (std::memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0
+            || h.version != CHECKPOINT_VERSION || h.headerSize != sizeof(CheckpointHeader)) {
+            std::cerr << path << " is not a version " << CHECKPOINT_VERSION << " checkpoint\n";
+            return false;
+        }
+        if (std::strncmp(h.game, game.c_str(), sizeof(h.game)) != 0) {
+            std::cerr << path << " is a checkpoint for " << h.game << ", not " << game << "\n";
+            return false;
+        }
+        uint64_t expected = sizeof(CheckpointHeader)
+                            + (2 * h.numNodes + 1) * sizeof(uint64_t)
+                            + 2 * h.numValues * sizeof(double);
+        if (file.size() != expected) {
+            std::cerr << "Checkpoint " << path << " is truncated\n";
+            return false;
+        }
+        return true;
+    }
+
+    const CheckpointHeader& header() const {
+        return *reinterpret_cast<const CheckpointHeader*>(file.data());
+    }
+
+    const uint64_t* keys() const {
+        return reinterpret_cast<const uint64_t*>(file.data() + sizeof(CheckpointHeader));
+    }
+
+    const uint64_t* offsets() const {
+        return keys() + header().numNodes;
+    }
+
+    const double* regretSum() const {
+        return reinterpret_cast<const double*>(offsets() + header().numNodes + 1);
+    }
+
+    const double* strategySum() const {
+        return regretSum() + header().numValues;
+    }
+
+private:
+    MappedFile file;
+};
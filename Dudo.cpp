@@ -1,101 +1,201 @@
 #include <iostream>
 #include <vector>
-#include <unordered_map>
 #include <string>
 #include <random>
 #include <algorithm>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
+#include <thread>
+#include <barrier>
+#include <chrono>
+#include <cmath>
+#include <array>
+#include <unordered_map>
 
-class DudoTrainer {
+#include "Checkpoint.h"
+#include "CFR.h"
+#include "Policy.h"
+#include "Bench.h"
+
+class DudoTrainer : public cfr::NodeStore<> {
 public:
     // Dudo definitions
-    const int NUM_SIDES = 6;
-    const int NUM_ACTIONS = (2 * NUM_SIDES) + 1;
-    const int DUDO = NUM_ACTIONS - 1;
+    static const int NUM_SIDES = 6;
+    static const int NUM_ACTIONS = (2 * NUM_SIDES) + 1;
+    static const int DUDO = NUM_ACTIONS - 1;
+    static const int NUM_HISTORIES = 1 << DUDO;
+    static const int NUM_INFO_SETS = NUM_SIDES * NUM_HISTORIES;
 
     std::vector<int> claimNum{1,1,1,1,1,1,2,2,2,2,2,2};
     std::vector<int> claimRank{2,3,4,5,6,1,2,3,4,5,6,1};
 
 
+    // View of one information set's slice of the flat node store
     struct Node {
         // min, max are inclusive
         int MIN_ACTION;
         int MAX_ACTION;
         int NUM_ACTIONS;
-        std::string infoSet;
-
-        std::vector<double> regretSum;
-        std::vector<double> strategy;
-        std::vector<double> strategySum;
-
-        Node(int minA, int maxA)
-            : MIN_ACTION(minA),
-              MAX_ACTION(maxA),
-              NUM_ACTIONS(maxA - minA + 1),
-              regretSum(NUM_ACTIONS, 0.0),
-              strategy(NUM_ACTIONS, 0.0),
-              strategySum(NUM_ACTIONS, 0.0) {}
 
-        const std::vector<double>& getStrategy(double realizationWeight) {
-            double normalizingSum = 0.0;
+        double* regretSum;
+        double* strategySum;
 
-            for (int i = 0; i < NUM_ACTIONS; i++) {
-                strategy[i] = std::max(regretSum[i], 0.0);
-                normalizingSum += strategy[i];
-            }
-
-            for (int i = 0; i < NUM_ACTIONS; i++) {
-                if (normalizingSum > 0) {
-                    strategy[i] /= normalizingSum;
-                }
-                else {
-                    strategy[i] = 1.0 / NUM_ACTIONS;
-                }
-                strategySum[i] += realizationWeight * strategy[i];
-            }
+        // Regret-matching strategy computed without modifying the node, for concurrent readers
+        void getStrategy(double* strategy) const {
+            cfr::regretMatch(regretSum, strategy, NUM_ACTIONS);
+        }
 
-            return strategy;
+        void getStrategy(double* strategy, double realizationWeight) {
+            cfr::regretMatchAccumulate(regretSum, strategy, strategySum, NUM_ACTIONS, realizationWeight);
         }
 
         std::vector<double> getAverageStrategy() const {
             std::vector<double> avg(NUM_ACTIONS);
-            double normalizingSum = 0.0;
+            getAverageStrategy(avg.data());
+            return avg;
+        }
 
-            for (int i = 0; i < NUM_ACTIONS; i++) {
-                normalizingSum += strategySum[i];
-            }
-            for (int i = 0; i < NUM_ACTIONS; i++) {
-                if (normalizingSum > 0) {
-                    avg[i] = strategySum[i] / normalizingSum;
-                }
-                else {
-                    avg[i] = 1.0 / NUM_ACTIONS;
+        void getAverageStrategy(double* avg) const {
+            cfr::averageStrategy(strategySum, avg, NUM_ACTIONS);
+        }
+    };
+
+    // The node store holds slot s = key - NUM_HISTORIES at node s, since the information set
+    // key infoSetToInteger(roll, history) is roll * NUM_HISTORIES + claim mask. Each slot
+    // has a value per legal action; illegal actions get no storage.
+
+    // Payoff to the player who made claim c when DUDO is called on it,
+    // claimPayoff[c][r][s] for the two dice showing r + 1 and s + 1. Every terminal is
+    // evaluated from it, and the vector traversals take whole rows claimPayoff[c].
+    double claimPayoff[DUDO][NUM_SIDES][NUM_SIDES];
+
+    // How accumulated regrets and strategy sums are weighted across iterations. Vanilla
+    // resets strategySum after 20% of the iterations.
+    using UpdateRule = cfr::UpdateRule;
+    UpdateRule updateRule = UpdateRule::Vanilla;
+    double alpha = 1.5;
+    double beta = 0.0;
+    double gamma = 2.0;
+    // Apply the update rule once per block of discountEvery iterations, each block counting as
+    // one iteration, so that cheap sampled iterations aren't dominated by the full-table pass
+    int discountEvery = 1;
+
+    // Monte Carlo CFR traversals for trainMonteCarlo
+    enum class Sampling {
+        External,  // sample chance and opponent actions, walk every traverser action
+        Outcome    // sample a single trajectory, corrected with importance weights
+    };
+    // Exploration applied to the traverser's sampling policy in outcome sampling
+    double epsilon = 0.6;
+
+    // Print exploitability every evalEvery iterations (0 = only at the end of training)
+    int evalEvery = 0;
+    // Print progress every printEvery iterations (0 = never, the default: long runs report
+    // progress through telemetry), and the final values, exploitability and prune statistics
+    // after training unless printSummary is off
+    int printEvery = 0;
+    bool printSummary = true;
+
+    // Deals per thread per round of trainParallel, so a round of N threads plays
+    // mergeEvery * N deals. Within a round every deal sees the regrets as they were at its
+    // start: more threads or a larger mergeEvery mean staler regrets and slower convergence
+    // per deal, while a smaller one spends more of each round merging and waiting.
+    int mergeEvery = 16;
+
+    // Information sets visited by the traversals, for benchmarks
+    uint64_t nodesTouched = 0;
+
+    // Update-rule iterations completed so far, carried across checkpoints
+    int iteration = 0;
+
+    // Regret-based pruning: skip the subtree under an action the current strategy doesn't
+    // play and whose regret is below pruneThreshold. Every pruneRecheckEvery-th iteration
+    // walks the full tree and weights the regret update of such an action by
+    // pruneRecheckEvery, for the iterations that skipped it. -20 was tuned on chance-sampled
+    // CFR: at 100k deals it walks 5.7x fewer edges than an unpruned run, and reaches a
+    // lower exploitability in the same time.
+    bool pruning = false;
+    double pruneThreshold = -20.0;
+    int pruneRecheckEvery = 20;
+    // Whether the current iteration prunes, set at the start of each iteration
+    bool pruneActive = false;
+
+    // Alternating updates for train: each iteration traverses once per updating player, and
+    // only that player's regrets change. The other player's actions with probability zero
+    // give the updater no counterfactual weight and are skipped.
+    bool alternating = false;
+
+    // Action edges below decision nodes that were considered and skipped, and edges skipped
+    // by alternating traversals because the opponent never takes them
+    struct PruneStats {
+        uint64_t edges = 0;
+        uint64_t pruned = 0;
+        uint64_t zeroReach = 0;
+    };
+    PruneStats pruneStats;
+
+    // Per-thread regret and strategy increments, laid out like regretSum/strategySum, and
+    // whether each slot has any this round
+    struct ThreadDelta {
+        std::vector<double> regretSum;
+        std::vector<double> strategySum;
+        std::vector<uint8_t> touched;
+        double util = 0.0;
+        PruneStats pruneStats;
+        uint64_t nodesTouched = 0;
+    };
+
+    DudoTrainer() {
+        for (int slot = 0; slot < NUM_INFO_SETS; slot++) {
+            addNode(slot + NUM_HISTORIES, numActions(slot % NUM_HISTORIES));
+        }
+
+        for (int c = 0; c < DUDO; c++) {
+            for (int r = 0; r < NUM_SIDES; r++) {
+                for (int s = 0; s < NUM_SIDES; s++) {
+                    int nums[2] = {r + 1, s + 1};
+                    claimPayoff[c][r][s] = dudoUtility(nums, c);
                 }
             }
-            return avg;
         }
+    }
 
-        std::string toString() const {
-            std::ostringstream out;
-            out << std::setw(4) << infoSet << ": [";
-            auto avg = getAverageStrategy();
-            for (size_t i = 0; i < avg.size(); i++) {
-                out << std::fixed << std::setprecision(5) << avg[i];
-                if (i + 1 < avg.size()) out << " ";
+    // First legal action after the claims in mask, i.e. one past the highest claim made
+    static int minAction(int mask) {
+        int lastClaim = -1;
+        for (int a = DUDO - 1; a >= 0; a--) {
+            if ((mask >> a) & 1) {
+                lastClaim = a;
+                break;
             }
-            out << "]";
-            return out.str();
         }
-    };
+        return lastClaim + 1;
+    }
 
-    std::unordered_map<uint64_t, Node> nodeMap;
+    // DUDO can't be called before any claim has been made
+    static int numActions(int mask) {
+        return (mask != 0 ? DUDO : DUDO - 1) - minAction(mask) + 1;
+    }
 
-    // Convert Dudo claim history to a string
-    std::string claimHistoryToString(const std::vector<bool>& isClaimed) {
+    Node getNode(uint64_t infoSetNum) {
+        int slot = infoSetNum - NUM_HISTORIES;
+        int begin = offset[slot];
+        int n = offset[slot + 1] - begin;
+        int minA = (slot % NUM_HISTORIES != 0) ? NUM_ACTIONS - n : 0;
+        return Node{minA, minA + n - 1, n, &regretSum[begin], &strategySum[begin]};
+    }
+
+    // Bytes used by the node store
+    size_t memoryUsage() const {
+        return storeBytes();
+    }
+
+    // Convert Dudo claim history (bit a set if claim a was made) to a string
+    std::string claimHistoryToString(int isClaimed) const {
         std::string s;
         for (int a = 0; a < DUDO; a++) {
-            if (isClaimed[a]) {
+            if ((isClaimed >> a) & 1) {
                 if (!s.empty()) s += ",";
                 s += std::to_string(claimNum[a]) + "*" + std::to_string(claimRank[a]);
             }
@@ -104,138 +204,1402 @@ public:
     }
 
     // Convert Dudo information set to an integer
-    uint64_t infoSetToInteger(int playerRoll, const std::vector<bool>& isClaimed) {
-        uint64_t infoSetNum = playerRoll;
-        for (int a = NUM_ACTIONS - 2; a >= 0; a--) {
-            infoSetNum = (infoSetNum << 1) | (isClaimed[a] ? 1 : 0);
+    uint64_t infoSetToInteger(int playerRoll, int isClaimed) const {
+        return ((uint64_t) playerRoll << DUDO) | isClaimed;
+    }
+
+    // Readable label of an information set, e.g. "3 1*2,1*5: [...]", built only for output
+    std::string nodeToString(int slot) {
+        int roll = slot / NUM_HISTORIES + 1;
+        int history = slot % NUM_HISTORIES;
+        Node node = getNode(slot + NUM_HISTORIES);
+
+        std::ostringstream out;
+        out << std::setw(4) << std::to_string(roll) + claimHistoryToString(history) << ": [";
+        auto avg = node.getAverageStrategy();
+        for (size_t i = 0; i < avg.size(); i++) {
+            out << std::fixed << std::setprecision(5) << avg[i];
+            if (i + 1 < avg.size()) out << " ";
         }
-        return infoSetNum;
+        out << "]";
+        return out.str();
     }
 
-    double cfr(const std::vector<int>& nums,
-               std::vector<bool>& history,
-               double p0, double p1,
-               int lastAction) {
+    // Dice of deal number deal, drawn from its Philox stream under key
+    static void dealDice(uint64_t key, uint64_t deal, int* nums) {
+        cfr::Philox gen(key, deal);
+        nums[0] = 1 + gen.below(NUM_SIDES);
+        nums[1] = 1 + gen.below(NUM_SIDES);
+    }
+
+    // Utility for the player who made lastClaim when the opponent calls DUDO on it
+    double dudoUtility(const int* nums, int lastClaim) const {
+        int count = claimNum[lastClaim];
+        int rank = claimRank[lastClaim];
+
+        for (int i = 0; i < 2; i++) {
+            if (nums[i] == 1 || nums[i] == rank) count--;
+        }
+
+        return (count <= 0) ? 1.0 : -1.0;
+    }
+
+    // dudoUtility from the precomputed table, a single load
+    double claimerPayoff(const int* nums, int lastClaim) const {
+        return claimPayoff[lastClaim][nums[0] - 1][nums[1] - 1];
+    }
+
+    // Weight of this iteration's regret update for an action with this regret and current
+    // probability: 0 if its subtree is skipped, and pruneRecheckEvery on a recheck iteration
+    // for an action that the other iterations skip, standing in for the updates they missed
+    double pruneWeight(double regret, double probability, PruneStats& stats) const {
+        if (!pruning) {
+            return 1.0;
+        }
+        stats.edges++;
+        if (probability != 0.0 || regret >= pruneThreshold) {
+            return 1.0;
+        }
+        if (!pruneActive) {
+            return pruneRecheckEvery;
+        }
+        stats.pruned++;
+        return 0.0;
+    }
+
+    // Print the average game value, table size, exploitability and prune statistics
+    void printResults(double avgGameValue) {
+        if (!printSummary) {
+            return;
+        }
+        std::cout << "Final average game value: " << avgGameValue << "\n";
+        std::cout << NUM_INFO_SETS << " information sets, " << memoryUsage() / 1024 << " KB\n";
+        std::cout << "Exploitability: " << exploitability() << "\n";
+        printPruneStats();
+    }
+
+    void printPruneStats() const {
+        if (pruning) {
+            std::cout << "Pruned " << pruneStats.pruned << " of " << pruneStats.edges << " action edges ("
+                      << 100.0 * pruneStats.pruned / std::max<uint64_t>(pruneStats.edges, 1) << "%)\n";
+        }
+        if (alternating) {
+            std::cout << "Skipped " << pruneStats.zeroReach << " zero-reach opponent edges\n";
+        }
+    }
+
+    // history is the claim mask, plays the number of claims made so far and lastClaim the
+    // most recent one (-1 before any), so a visit needs no scanning and no heap allocation.
+    // Calling DUDO is terminal and is looked up in claimPayoff rather than recursed into.
+    double cfr(const int* nums, int history, int plays, int lastClaim, double p0, double p1) {
+        int player = plays % 2;
+        nodesTouched++;
+        CFR_TELEMETRY_VISIT(plays, 1);
+        // DUDO is legal once a claim has been made
+        CFR_TELEMETRY_TERMINAL(history != 0);
+
+        Node node = getNode(infoSetToInteger(nums[player], history));
+
+        double strategy[NUM_ACTIONS];
+        node.getStrategy(strategy, player == 0 ? p0 : p1);
+        double util[NUM_ACTIONS];
+        double weight[NUM_ACTIONS];
+        double nodeUtil = 0.0;
+
+        for (int a = 0; a < node.NUM_ACTIONS; a++) {
+            int action = node.MIN_ACTION + a;
+            weight[a] = 1.0;
+
+            if (action == DUDO)
+                util[a] = -claimerPayoff(nums, lastClaim);
+            else if ((weight[a] = pruneWeight(node.regretSum[a], strategy[a], pruneStats)) == 0.0)
+                util[a] = 0.0;
+            else if (player == 0)
+                util[a] = -cfr(nums, history | (1 << action), plays + 1, action, p0 * strategy[a], p1);
+            else
+                util[a] = -cfr(nums, history | (1 << action), plays + 1, action, p0, p1 * strategy[a]);
+
+            nodeUtil += strategy[a] * util[a];
+        }
+
+        double cfWeight = (player == 0) ? p1 : p0;
+        for (int a = 0; a < node.NUM_ACTIONS; a++) {
+            node.regretSum[a] += weight[a] * cfWeight * (util[a] - nodeUtil);
+        }
 
-        int plays = std::count(history.begin(), history.end(), true);
+        return nodeUtil;
+    }
+
+    // Alternating-update traversal for updater, returning the utility of the player to act.
+    // pOpponent is the opponent's reach, which weights updater's regrets. The opponent's
+    // average strategy is accumulated here rather than in its own pass, with the same weight:
+    // an action it never takes leaves zero weight on everything below, so it is skipped.
+    double cfrAlternating(const int* nums, int history, int plays, int lastClaim, int updater,
+                          double pOpponent) {
         int player = plays % 2;
+        nodesTouched++;
+        CFR_TELEMETRY_VISIT(plays, 1);
+        CFR_TELEMETRY_TERMINAL(history != 0);
+
+        Node node = getNode(infoSetToInteger(nums[player], history));
 
-        if (plays > 1 && lastAction == DUDO) {
-            int lastClaim = -1;
-            for (int a = DUDO - 1; a >= 0; a--) {
-                if (history[a]) {
-                    lastClaim = a;
-                    break;
+        double strategy[NUM_ACTIONS];
+        double util[NUM_ACTIONS];
+        double nodeUtil = 0.0;
+
+        if (player != updater) {
+            node.getStrategy(strategy, pOpponent);
+            for (int a = 0; a < node.NUM_ACTIONS; a++) {
+                int action = node.MIN_ACTION + a;
+                if (strategy[a] == 0.0) {
+                    pruneStats.zeroReach++;
+                    continue;
                 }
+                if (action == DUDO)
+                    util[a] = -claimerPayoff(nums, lastClaim);
+                else
+                    util[a] = -cfrAlternating(nums, history | (1 << action), plays + 1, action, updater,
+                                              pOpponent * strategy[a]);
+                nodeUtil += strategy[a] * util[a];
             }
+            return nodeUtil;
+        }
 
-            int count = claimNum[lastClaim];
-            int rank = claimRank[lastClaim];
+        node.getStrategy(strategy);
+        double weight[NUM_ACTIONS];
 
-            for (int n : nums) {
-                if (n == 1 || n == rank) count--;
-            }
+        for (int a = 0; a < node.NUM_ACTIONS; a++) {
+            int action = node.MIN_ACTION + a;
+            weight[a] = 1.0;
 
-            // std::cout << "DUDO CALLED: "<< std::endl;
-            // for (int i = 0; i < history.size(); i++) {
-            //     std::cout << history[i] << ", ";
-            // }
-            // std::cout << std::endl;
-            // for (int i = 0; i < history.size()-1; i++) {
-            //     if (history[i]) {
-            //         std::cout << claimNum[i] << "*" << claimRank[i] << ",";
-            //     }
-            // }
-            // std::cout << "DUDO" << std::endl;
-            // std::cout << "player: " << player << ", num0: " << nums[player] << ", num1: " << nums[1-player] << std::endl;
-            // std::cout << "winner: " << ((count <= 0) ? player : 1-player) << std::endl;
+            if (action == DUDO)
+                util[a] = -claimerPayoff(nums, lastClaim);
+            else if ((weight[a] = pruneWeight(node.regretSum[a], strategy[a], pruneStats)) == 0.0)
+                util[a] = 0.0;
+            else
+                util[a] = -cfrAlternating(nums, history | (1 << action), plays + 1, action, updater, pOpponent);
 
-            return (count <= 0) ? 1.0 : -1.0;
+            nodeUtil += strategy[a] * util[a];
         }
 
-        std::string infoSetStr = std::to_string(nums[player]) + claimHistoryToString(history);
+        for (int a = 0; a < node.NUM_ACTIONS; a++) {
+            node.regretSum[a] += weight[a] * pOpponent * (util[a] - nodeUtil);
+        }
+
+        return nodeUtil;
+    }
+
+    // Same traversal as cfr, but reads regrets from the shared nodes and writes
+    // regret/strategy increments into the calling thread's delta instead
+    double cfrWorker(const int* nums, int history, int plays, int lastClaim,
+                     double p0, double p1, ThreadDelta& delta) {
+        int player = plays % 2;
+        delta.nodesTouched++;
+
         uint64_t infoSetNum = infoSetToInteger(nums[player], history);
+        const Node node = getNode(infoSetNum);
+        delta.touched[infoSetNum - NUM_HISTORIES] = 1;
+        int begin = offset[infoSetNum - NUM_HISTORIES];
+        double* regretDelta = &delta.regretSum[begin];
+        double* strategyDelta = &delta.strategySum[begin];
 
-        Node* node;
-        if (nodeMap.count(infoSetNum)) {
-            node = &nodeMap.at(infoSetNum);
-        } else {
-            // Create the node for the infoSet if it doesn't exist
-            int maxA = (plays > 0) ? DUDO : DUDO - 1;
-            nodeMap.emplace(infoSetNum, Node(lastAction + 1, maxA));
-            node = &nodeMap.at(infoSetNum);
-            node->infoSet = infoSetStr;
+        double strategy[NUM_ACTIONS];
+        node.getStrategy(strategy);
+        double realizationWeight = (player == 0) ? p0 : p1;
+        for (int a = 0; a < node.NUM_ACTIONS; a++) {
+            strategyDelta[a] += realizationWeight * strategy[a];
         }
 
-        const auto& strategy = node->getStrategy(player == 0 ? p0 : p1);
-        std::vector<double> util(node->NUM_ACTIONS);
+        double util[NUM_ACTIONS];
+        double weight[NUM_ACTIONS];
         double nodeUtil = 0.0;
 
-        for (int a = 0; a < node->NUM_ACTIONS; a++) {
-            history[node->MIN_ACTION + a] = true;
+        for (int a = 0; a < node.NUM_ACTIONS; a++) {
+            int action = node.MIN_ACTION + a;
+            weight[a] = 1.0;
 
-            if (player == 0)
-                util[a] = -cfr(nums, history, p0 * strategy[a], p1, node->MIN_ACTION + a);
+            if (action == DUDO)
+                util[a] = -claimerPayoff(nums, lastClaim);
+            else if ((weight[a] = pruneWeight(node.regretSum[a], strategy[a], delta.pruneStats)) == 0.0)
+                util[a] = 0.0;
+            else if (player == 0)
+                util[a] = -cfrWorker(nums, history | (1 << action), plays + 1, action, p0 * strategy[a], p1, delta);
             else
-                util[a] = -cfr(nums, history, p0, p1 * strategy[a], node->MIN_ACTION + a);
+                util[a] = -cfrWorker(nums, history | (1 << action), plays + 1, action, p0, p1 * strategy[a], delta);
 
-            history[node->MIN_ACTION + a] = false;
             nodeUtil += strategy[a] * util[a];
         }
 
         double cfWeight = (player == 0) ? p1 : p0;
-        for (int a = 0; a < node->NUM_ACTIONS; a++) {
-            node->regretSum[a] += cfWeight * (util[a] - nodeUtil);
+        for (int a = 0; a < node.NUM_ACTIONS; a++) {
+            regretDelta[a] += weight[a] * cfWeight * (util[a] - nodeUtil);
         }
 
         return nodeUtil;
     }
 
-    void resetStrategySums() {
-        for (auto& [k , v] : nodeMap) {
-            for (int i = 0; i < v.strategySum.size(); i++) {
-                v.strategySum[i] = 0.0;
+    // pruneWeight for a public action, which can be pruned only if it is prunable for every roll
+    double prunePublicWeight(const Node* nodes, const double strategy[][NUM_ACTIONS], int a) {
+        if (!pruning) {
+            return 1.0;
+        }
+        pruneStats.edges++;
+        for (int r = 0; r < NUM_SIDES; r++) {
+            if (strategy[r][a] != 0.0 || nodes[r].regretSum[a] >= pruneThreshold) {
+                return 1.0;
             }
         }
+        if (!pruneActive) {
+            return pruneRecheckEvery;
+        }
+        pruneStats.pruned++;
+        return 0.0;
     }
 
+    // Public-tree CFR over all 36 deals at once. reach[i][r] is player i's probability of
+    // reaching this claim history holding roll r + 1, including the chance of the roll.
+    // On return util[i][r] is player i's counterfactual value holding roll r + 1.
+    // Every inner loop runs over the NUM_SIDES roll lanes so it vectorizes.
+    void cfrVector(int history, int plays, int lastClaim,
+                   const double reach[2][NUM_SIDES], double util[2][NUM_SIDES]) {
+        int player = plays % 2;
+        int opponent = 1 - player;
+        nodesTouched += NUM_SIDES;
+        CFR_TELEMETRY_VISIT(plays, NUM_SIDES);
+        CFR_TELEMETRY_TERMINAL(history != 0 ? NUM_SIDES * NUM_SIDES : 0);
+
+        Node nodes[NUM_SIDES];
+        double strategy[NUM_SIDES][NUM_ACTIONS];
+        for (int r = 0; r < NUM_SIDES; r++) {
+            nodes[r] = getNode(infoSetToInteger(r + 1, history));
+            nodes[r].getStrategy(strategy[r], reach[player][r]);
+        }
+        int minA = nodes[0].MIN_ACTION;
+        int n = nodes[0].NUM_ACTIONS;
+
+        double actionUtil[NUM_ACTIONS][NUM_SIDES];
+        double weight[NUM_ACTIONS];
+        for (int r = 0; r < NUM_SIDES; r++) {
+            util[player][r] = 0.0;
+            util[opponent][r] = 0.0;
+        }
+
+        for (int a = 0; a < n; a++) {
+            int action = minA + a;
+            weight[a] = 1.0;
+
+            if (action == DUDO) {
+                // The opponent made lastClaim, so claimPayoff is theirs
+                const double (*payoff)[NUM_SIDES] = claimPayoff[lastClaim];
+                for (int r = 0; r < NUM_SIDES; r++) {
+                    double u = 0.0;
+                    for (int s = 0; s < NUM_SIDES; s++) {
+                        u += reach[opponent][s] * payoff[r][s];
+                    }
+                    actionUtil[a][r] = -u;
+                }
+                for (int s = 0; s < NUM_SIDES; s++) {
+                    double u = 0.0;
+                    for (int r = 0; r < NUM_SIDES; r++) {
+                        u += reach[player][r] * strategy[r][a] * payoff[r][s];
+                    }
+                    util[opponent][s] += u;
+                }
+            }
+            else if ((weight[a] = prunePublicWeight(nodes, strategy, a)) == 0.0) {
+                // No roll plays the action, so the opponent's values below it are all zero
+                for (int r = 0; r < NUM_SIDES; r++) {
+                    actionUtil[a][r] = 0.0;
+                }
+            }
+            else {
+                double childReach[2][NUM_SIDES];
+                double childUtil[2][NUM_SIDES];
+                for (int r = 0; r < NUM_SIDES; r++) {
+                    childReach[player][r] = reach[player][r] * strategy[r][a];
+                    childReach[opponent][r] = reach[opponent][r];
+                }
+                cfrVector(history | (1 << action), plays + 1, action, childReach, childUtil);
+                for (int r = 0; r < NUM_SIDES; r++) {
+                    actionUtil[a][r] = childUtil[player][r];
+                    util[opponent][r] += childUtil[opponent][r];
+                }
+            }
+
+            for (int r = 0; r < NUM_SIDES; r++) {
+                util[player][r] += strategy[r][a] * actionUtil[a][r];
+            }
+        }
+
+        // Counterfactual values already carry the opponent's reach
+        for (int r = 0; r < NUM_SIDES; r++) {
+            for (int a = 0; a < n; a++) {
+                nodes[r].regretSum[a] += weight[a] * (actionUtil[a][r] - util[player][r]);
+            }
+        }
+    }
+
+    // Utility for traverser when player calls DUDO on the opponent's lastClaim
+    double terminalUtility(const int* nums, int lastClaim, int player, int traverser) const {
+        double claimerUtil = claimerPayoff(nums, lastClaim);
+        return (traverser == player) ? -claimerUtil : claimerUtil;
+    }
+
+    // External-sampling MCCFR. Every action of traverser is walked and one action of the
+    // opponent is sampled from its current strategy; the opponent's average strategy is
+    // accumulated at the sampled nodes. Returns traverser's sampled counterfactual value.
+    double cfrExternal(const int* nums, int history, int plays, int lastClaim,
+                       int traverser, cfr::Philox& gen) {
+        int player = plays % 2;
+        nodesTouched++;
+        CFR_TELEMETRY_VISIT(plays, 1);
+
+        Node node = getNode(infoSetToInteger(nums[player], history));
+        double strategy[NUM_ACTIONS];
+        node.getStrategy(strategy);
+
+        if (player != traverser) {
+            for (int a = 0; a < node.NUM_ACTIONS; a++) {
+                node.strategySum[a] += strategy[a];
+            }
+            int a = cfr::sampleAction(strategy, node.NUM_ACTIONS, gen);
+            int action = node.MIN_ACTION + a;
+            if (action == DUDO) {
+                CFR_TELEMETRY_TERMINAL(1);
+                return terminalUtility(nums, lastClaim, player, traverser);
+            }
+            return cfrExternal(nums, history | (1 << action), plays + 1, action, traverser, gen);
+        }
+
+        double util[NUM_ACTIONS];
+        double weight[NUM_ACTIONS];
+        double nodeUtil = 0.0;
+        CFR_TELEMETRY_TERMINAL(history != 0);
+
+        for (int a = 0; a < node.NUM_ACTIONS; a++) {
+            int action = node.MIN_ACTION + a;
+            weight[a] = 1.0;
+
+            if (action == DUDO)
+                util[a] = terminalUtility(nums, lastClaim, player, traverser);
+            else if ((weight[a] = pruneWeight(node.regretSum[a], strategy[a], pruneStats)) == 0.0)
+                util[a] = 0.0;
+            else
+                util[a] = cfrExternal(nums, history | (1 << action), plays + 1, action, traverser, gen);
+
+            nodeUtil += strategy[a] * util[a];
+        }
+
+        for (int a = 0; a < node.NUM_ACTIONS; a++) {
+            node.regretSum[a] += weight[a] * (util[a] - nodeUtil);
+        }
+
+        return nodeUtil;
+    }
+
+    // Outcome-sampling MCCFR along one trajectory. The traverser samples from an
+    // epsilon-exploring mix of its strategy, the opponent from its strategy. pTraverser and
+    // pOpponent are the players' reach probabilities and sampleProb the probability of having
+    // sampled this history. Returns traverser's terminal utility divided by the probability of
+    // sampling the whole trajectory, and sets tail to the strategy probability from here to it.
+    double cfrOutcome(const int* nums, int history, int plays, int lastClaim, int traverser,
+                      double pTraverser, double pOpponent, double sampleProb,
+                      double& tail, cfr::Philox& gen) {
+        int player = plays % 2;
+        nodesTouched++;
+        CFR_TELEMETRY_VISIT(plays, 1);
+
+        Node node = getNode(infoSetToInteger(nums[player], history));
+        double strategy[NUM_ACTIONS];
+        node.getStrategy(strategy);
+
+        double sampling[NUM_ACTIONS];
+        for (int a = 0; a < node.NUM_ACTIONS; a++) {
+            sampling[a] = (player == traverser)
+                ? epsilon / node.NUM_ACTIONS + (1.0 - epsilon) * strategy[a]
+                : strategy[a];
+        }
+        int sampled = cfr::sampleAction(sampling, node.NUM_ACTIONS, gen);
+        int action = node.MIN_ACTION + sampled;
+        double childSampleProb = sampleProb * sampling[sampled];
+
+        double util;
+        double childTail = 1.0;
+        CFR_TELEMETRY_TERMINAL(action == DUDO);
+        if (action == DUDO)
+            util = terminalUtility(nums, lastClaim, player, traverser) / childSampleProb;
+        else if (player == traverser)
+            util = cfrOutcome(nums, history | (1 << action), plays + 1, action, traverser,
+                              pTraverser * strategy[sampled], pOpponent, childSampleProb, childTail, gen);
+        else
+            util = cfrOutcome(nums, history | (1 << action), plays + 1, action, traverser,
+                              pTraverser, pOpponent * strategy[sampled], childSampleProb, childTail, gen);
+
+        if (player == traverser) {
+            double w = util * pOpponent;
+            for (int a = 0; a < node.NUM_ACTIONS; a++) {
+                node.regretSum[a] += (a == sampled)
+                    ? w * childTail * (1.0 - strategy[sampled])
+                    : -w * childTail * strategy[sampled];
+            }
+        }
+        else {
+            for (int a = 0; a < node.NUM_ACTIONS; a++) {
+                node.strategySum[a] += pOpponent / sampleProb * strategy[a];
+            }
+        }
+
+        tail = childTail * strategy[sampled];
+        return util;
+    }
+
+    // Value of brPlayer's best response to the average strategy of the other player, over
+    // the public claim tree below this history. oppReach[s] is the opponent's probability of
+    // reaching it holding roll s + 1, chance included. On return value[r] is the best
+    // responder's counterfactual value holding roll r + 1.
+    void bestResponse(int brPlayer, int history, int plays, int lastClaim,
+                      const double oppReach[NUM_SIDES], double value[NUM_SIDES]) {
+        int player = plays % 2;
+
+        for (int r = 0; r < NUM_SIDES; r++) {
+            value[r] = 0.0;
+        }
+        // Nothing below here is reached by the opponent, so every value is zero
+        double totalReach = 0.0;
+        for (int s = 0; s < NUM_SIDES; s++) {
+            totalReach += oppReach[s];
+        }
+        if (totalReach == 0.0) {
+            return;
+        }
+
+        int minA = (history != 0) ? minAction(history) : 0;
+        int n = numActions(history);
+
+        if (player == brPlayer) {
+            for (int r = 0; r < NUM_SIDES; r++) {
+                value[r] = -1e300;
+            }
+            for (int a = 0; a < n; a++) {
+                int action = minA + a;
+                double actionValue[NUM_SIDES];
+
+                if (action == DUDO) {
+                    // The opponent made lastClaim, so claimPayoff is theirs
+                    const double (*payoff)[NUM_SIDES] = claimPayoff[lastClaim];
+                    for (int r = 0; r < NUM_SIDES; r++) {
+                        double u = 0.0;
+                        for (int s = 0; s < NUM_SIDES; s++) {
+                            u += oppReach[s] * payoff[r][s];
+                        }
+                        actionValue[r] = -u;
+                    }
+                }
+                else {
+                    bestResponse(brPlayer, history | (1 << action), plays + 1, action, oppReach, actionValue);
+                }
+
+                for (int r = 0; r < NUM_SIDES; r++) {
+                    value[r] = std::max(value[r], actionValue[r]);
+                }
+            }
+            return;
+        }
+
+        double strategy[NUM_SIDES][NUM_ACTIONS];
+        for (int s = 0; s < NUM_SIDES; s++) {
+            getNode(infoSetToInteger(s + 1, history)).getAverageStrategy(strategy[s]);
+        }
+
+        for (int a = 0; a < n; a++) {
+            int action = minA + a;
+
+            if (action == DUDO) {
+                // The best responder made lastClaim
+                const double (*payoff)[NUM_SIDES] = claimPayoff[lastClaim];
+                for (int r = 0; r < NUM_SIDES; r++) {
+                    double u = 0.0;
+                    for (int s = 0; s < NUM_SIDES; s++) {
+                        u += oppReach[s] * strategy[s][a] * payoff[r][s];
+                    }
+                    value[r] += u;
+                }
+            }
+            else {
+                double childReach[NUM_SIDES];
+                double childValue[NUM_SIDES];
+                for (int s = 0; s < NUM_SIDES; s++) {
+                    childReach[s] = oppReach[s] * strategy[s][a];
+                }
+                bestResponse(brPlayer, history | (1 << action), plays + 1, action, childReach, childValue);
+                for (int r = 0; r < NUM_SIDES; r++) {
+                    value[r] += childValue[r];
+                }
+            }
+        }
+    }
+
+    // Expected value of player brPlayer's best response against the average strategy
+    double bestResponseValue(int brPlayer) {
+        double oppReach[NUM_SIDES];
+        double value[NUM_SIDES];
+        for (int s = 0; s < NUM_SIDES; s++) {
+            oppReach[s] = 1.0 / NUM_SIDES;
+        }
+        bestResponse(brPlayer, 0, 0, -1, oppReach, value);
+
+        double brValue = 0.0;
+        for (int r = 0; r < NUM_SIDES; r++) {
+            brValue += value[r] / NUM_SIDES;
+        }
+        return brValue;
+    }
+
+    // Average amount each best response gains over the game value; zero at a Nash equilibrium
+    double exploitability() {
+        return (bestResponseValue(0) + bestResponseValue(1)) / 2.0;
+    }
+
+    void printExploitability(int iteration) {
+        double br0 = bestResponseValue(0);
+        double br1 = bestResponseValue(1);
+        std::cout << "Iteration: " << iteration << ", best response values: " << br0 << ", " << br1
+                  << ", exploitability: " << (br0 + br1) / 2.0 << "\n";
+    }
+
+    // Save the node store and iteration count to a binary checkpoint
+    bool saveCheckpoint(const std::string& path) const {
+        return NodeStore::saveCheckpoint(path, "Dudo", iteration);
+    }
+
+    // Write the average strategies as a policy table keyed by infoSetToInteger
+    bool exportPolicy(const std::string& path) const {
+        return NodeStore::exportPolicy(path, "Dudo");
+    }
+
+    // Resume from a checkpoint written by saveCheckpoint
+    bool loadCheckpoint(const std::string& path) {
+        return NodeStore::loadCheckpoint(path, "Dudo", iteration);
+    }
+
+    // Discount the accumulated sums at the end of iteration t (starting at 1). Scaling the
+    // sums by t / (t + 1) every iteration is the same as weighting iteration t's updates by t.
+    void applyUpdateRule(int t) {
+        if (t % discountEvery != 0) {
+            return;
+        }
+        t /= discountEvery;
+
+        cfr::UpdateScales scales;
+        if (cfr::updateRuleScales(updateRule, alpha, beta, gamma, t, scales)) {
+            cfr::discount(scales, regretSum.data(), strategySum.data(), regretSum.size());
+        }
+    }
+
+    // Train with chance-sampled CFR, drawing deal i from Philox stream i
     void train(int iterations) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<int> die(1, 6);
+        uint64_t key = cfr::makeStreamKey();
+
+        double util = 0.0;
+
+        int resetIndex = iterations / 5;
+        // A resumed run keeps the strategy sums it was loaded with
+        bool resumed = iteration > 0;
+
+        for (int i = 0; i < iterations; i++) {
+            // Reset strategySum after 20% of the iterations
+            if (updateRule == UpdateRule::Vanilla && !resumed && i == resetIndex) {
+                CFR_TELEMETRY_PHASE(Reset);
+                resetStrategySums();
+            }
+
+            CFR_TELEMETRY_PHASE(Sample);
+            int nums[2];
+            dealDice(key, i, nums);
+
+            CFR_TELEMETRY_PHASE(Traverse);
+            pruneActive = pruning && iteration % pruneRecheckEvery != 0;
+            if (alternating) {
+                // Player 1 updates against the regrets player 0 has just updated
+                util += cfrAlternating(nums, 0, 0, -1, 0, 1.0);
+                cfrAlternating(nums, 0, 0, -1, 1, 1.0);
+            }
+            else {
+                util += cfr(nums, 0, 0, -1, 1.0, 1.0);
+            }
+            CFR_TELEMETRY_PHASE(Update);
+            applyUpdateRule(++iteration);
+            CFR_TELEMETRY_TICK(i + 1, memoryUsage());
+
+            if (evalEvery > 0 && (i + 1) % evalEvery == 0) {
+                printExploitability(i + 1);
+            }
+
+            if (printEvery > 0 && (i + 1) % printEvery == 0) {
+                std::cout << "Iteration: " << i + 1 << "\n";
+                std::cout << "Average game value: " << util / (i + 1) << "\n";
+            }
+        }
+
+        CFR_TELEMETRY_FINISH(iterations, memoryUsage());
+        printResults(util / iterations);
+
+    }
+
+    // Train with Monte Carlo CFR. Each iteration samples a deal and runs one traversal per
+    // player, drawing the deal and the sampled actions from Philox stream i.
+    void trainMonteCarlo(int iterations, Sampling sampling) {
+        uint64_t key = cfr::makeStreamKey();
+
+        double util = 0.0;
+
+        int resetIndex = iterations / 5;
+        // A resumed run keeps the strategy sums it was loaded with
+        bool resumed = iteration > 0;
+
+        for (int i = 0; i < iterations; i++) {
+            // Reset strategySum after 20% of the iterations
+            if (updateRule == UpdateRule::Vanilla && !resumed && i == resetIndex) {
+                CFR_TELEMETRY_PHASE(Reset);
+                resetStrategySums();
+            }
+
+            CFR_TELEMETRY_PHASE(Sample);
+            cfr::Philox gen(key, i);
+            int nums[2] = {1 + (int) gen.below(NUM_SIDES), 1 + (int) gen.below(NUM_SIDES)};
+
+            CFR_TELEMETRY_PHASE(Traverse);
+            pruneActive = pruning && iteration % pruneRecheckEvery != 0;
+            for (int traverser = 0; traverser < 2; traverser++) {
+                double value;
+                if (sampling == Sampling::External) {
+                    value = cfrExternal(nums, 0, 0, -1, traverser, gen);
+                }
+                else {
+                    double tail;
+                    value = cfrOutcome(nums, 0, 0, -1, traverser, 1.0, 1.0, 1.0, tail, gen) * tail;
+                }
+                if (traverser == 0) {
+                    util += value;
+                }
+            }
+            CFR_TELEMETRY_PHASE(Update);
+            applyUpdateRule(++iteration);
+            CFR_TELEMETRY_TICK(i + 1, memoryUsage());
+
+            if (evalEvery > 0 && (i + 1) % evalEvery == 0) {
+                printExploitability(i + 1);
+            }
+        }
+
+        CFR_TELEMETRY_FINISH(iterations, memoryUsage());
+        printResults(util / iterations);
+    }
+
+    // Train with public-tree CFR, one exact update over every deal per iteration
+    void trainVector(int iterations) {
+        double reach[2][NUM_SIDES];
+        double rootUtil[2][NUM_SIDES];
+        for (int r = 0; r < NUM_SIDES; r++) {
+            reach[0][r] = reach[1][r] = 1.0 / NUM_SIDES;
+        }
 
         double util = 0.0;
 
         int resetIndex = iterations / 5;
+        // A resumed run keeps the strategy sums it was loaded with
+        bool resumed = iteration > 0;
 
         for (int i = 0; i < iterations; i++) {
             // Reset strategySum after 20% of the iterations
-            if (i == resetIndex) {
+            if (updateRule == UpdateRule::Vanilla && !resumed && i == resetIndex) {
+                CFR_TELEMETRY_PHASE(Reset);
                 resetStrategySums();
             }
 
-            int d0 = die(gen);
-            int d1 = die(gen);
-            std::vector<bool> history(NUM_ACTIONS, false);
+            CFR_TELEMETRY_PHASE(Traverse);
+            pruneActive = pruning && iteration % pruneRecheckEvery != 0;
+            cfrVector(0, 0, -1, reach, rootUtil);
+            CFR_TELEMETRY_PHASE(Update);
+            applyUpdateRule(++iteration);
+            CFR_TELEMETRY_TICK(i + 1, memoryUsage());
 
-            util += cfr({d0, d1}, history, 1.0, 1.0, -1);
+            double gameValue = 0.0;
+            for (int r = 0; r < NUM_SIDES; r++) {
+                gameValue += rootUtil[0][r] / NUM_SIDES;
+            }
+            util += gameValue;
 
-            if (i % 100 == 0) {
+            if (evalEvery > 0 && (i + 1) % evalEvery == 0) {
+                printExploitability(i + 1);
+            }
+
+            if (printEvery > 0 && i % printEvery == 0) {
                 std::cout << "Iteration: " << i << "\n";
-                std::cout << "d0: " << d0 << ", d1: " << d1 << "\n";
-                std::cout << "Average game value: " << util / i << "\n";
+                std::cout << "Game value: " << gameValue << "\n";
+            }
+        }
+
+        CFR_TELEMETRY_FINISH(iterations, memoryUsage());
+        printResults(util / iterations);
+    }
+
+    // Train with chance-sampled CFR on numThreads threads. Each round plays mergeEvery sampled
+    // deals per thread against the regrets frozen at the start of the round; each thread
+    // accumulates its updates privately. The slots the threads touched are then merged into
+    // the nodes, with the slot range split across the same threads. The calling thread is
+    // thread 0, and the threads step through the rounds together at two barriers, the last
+    // to arrive at the second doing the round's bookkeeping.
+    void trainParallel(int iterations, int numThreads) {
+        int size = regretSum.size();
+
+        std::vector<ThreadDelta> deltas(numThreads);
+        for (auto& delta : deltas) {
+            delta.regretSum.assign(size, 0.0);
+            delta.strategySum.assign(size, 0.0);
+            delta.touched.assign(NUM_INFO_SETS, 0);
+        }
+
+        // Deals are numbered across threads, so the same deals are played whatever numThreads
+        // is, though in rounds of different sizes
+        uint64_t key = cfr::makeStreamKey();
+
+        int resetIndex = iterations / 5;
+        // A resumed run keeps the strategy sums it was loaded with
+        bool resumed = iteration > 0;
+        bool strategySumsReset = false;
+        int dealsDone = 0;
+        int roundDeals = 0;
+        int rounds = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        auto startRound = [&]() {
+            // Reset strategySum at the first round boundary after 20% of the iterations
+            if (updateRule == UpdateRule::Vanilla && !resumed && !strategySumsReset && dealsDone >= resetIndex) {
+                CFR_TELEMETRY_PHASE(Reset);
+                resetStrategySums();
+                strategySumsReset = true;
+            }
+            CFR_TELEMETRY_PHASE(Traverse);
+            roundDeals = std::min(iterations - dealsDone, mergeEvery * numThreads);
+            pruneActive = pruning && iteration % pruneRecheckEvery != 0;
+        };
+        auto finishRound = [&]() noexcept {
+            dealsDone += roundDeals;
+            rounds++;
+            applyUpdateRule(++iteration);
+            CFR_TELEMETRY_TICK(dealsDone, memoryUsage());
+
+            if (evalEvery > 0 && dealsDone / evalEvery != (dealsDone - roundDeals) / evalEvery) {
+                printExploitability(dealsDone);
+            }
+
+            if (printEvery > 0 && rounds % printEvery == 0) {
+                double util = 0.0;
+                for (auto& delta : deltas) util += delta.util;
+                std::cout << "Iteration: " << dealsDone << "\n";
+                std::cout << "Average game value: " << util / dealsDone << "\n";
+            }
+            if (dealsDone < iterations) {
+                startRound();
             }
+        };
+        if (dealsDone < iterations) {
+            startRound();
         }
 
-        std::cout << "Final average game value: " << util / iterations << "\n";
-        std::cout << nodeMap.size() << " information sets \n";
+        std::barrier traversed(numThreads, []() noexcept { CFR_TELEMETRY_PHASE(Update); });
+        std::barrier merged(numThreads, finishRound);
+        auto work = [&](int t) {
+            ThreadDelta& delta = deltas[t];
+            int slotBegin = (int64_t) NUM_INFO_SETS * t / numThreads;
+            int slotEnd = (int64_t) NUM_INFO_SETS * (t + 1) / numThreads;
+            while (dealsDone < iterations) {
+                int first = dealsDone + roundDeals * t / numThreads;
+                int last = dealsDone + roundDeals * (t + 1) / numThreads;
+                for (int i = first; i < last; i++) {
+                    int nums[2];
+                    dealDice(key, i, nums);
+                    delta.util += cfrWorker(nums, 0, 0, -1, 1.0, 1.0, delta);
+                }
+                traversed.arrive_and_wait();
+
+                // Merge the increments of this thread's slots, skipping the slots a thread
+                // didn't touch; pruned subtrees leave many
+                for (ThreadDelta& other : deltas) {
+                    for (int slot = slotBegin; slot < slotEnd; slot++) {
+                        if (!other.touched[slot]) continue;
+                        other.touched[slot] = 0;
+                        for (int i = offset[slot]; i < offset[slot + 1]; i++) {
+                            regretSum[i] += other.regretSum[i];
+                            strategySum[i] += other.strategySum[i];
+                            other.regretSum[i] = 0.0;
+                            other.strategySum[i] = 0.0;
+                        }
+                    }
+                }
+                merged.arrive_and_wait();
+            }
+        };
+        std::vector<std::thread> workers;
+        for (int t = 1; t < numThreads; t++) {
+            workers.emplace_back(work, t);
+        }
+        work(0);
+        for (auto& worker : workers) worker.join();
 
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double util = 0.0;
+        for (auto& delta : deltas) {
+            util += delta.util;
+            pruneStats.edges += delta.pruneStats.edges;
+            pruneStats.pruned += delta.pruneStats.pruned;
+            nodesTouched += delta.nodesTouched;
+        }
+
+        CFR_TELEMETRY_FINISH(iterations, memoryUsage());
+        printResults(util / iterations);
+        if (printSummary) {
+            std::cout << numThreads << " threads, " << iterations / seconds << " deals/sec\n";
+        }
     }
 };
 
 
-int main() {
+// Dudo with DICE dice per player, each with SIDES sides. Claims count dice across both
+// players, ordered by count and then by rank with wild 1s highest, as in the one-die table.
+// An information set is the player's roll as a multiset, ranked among the
+// C(SIDES + DICE - 1, DICE) sorted rolls, together with the claim mask, packed into
+// rollIndex << NUM_CLAIMS | mask. The full game tree grows as 2^NUM_CLAIMS, so the game is
+// modelled as a cfr::Game and trained by cfr::ExternalSamplingTrainer, which only stores the
+// information sets it visits. The root is a chance state dealing both rolls.
+template <int DICE, int SIDES>
+class MultiDudoGame {
+public:
+    static constexpr int NUM_CLAIMS = 2 * DICE * SIDES;
+    static constexpr int NUM_ACTIONS = NUM_CLAIMS + 1;
+    static constexpr int DUDO = NUM_CLAIMS;
+
+    static constexpr uint64_t binomial(int n, int k) {
+        uint64_t result = 1;
+        for (int i = 1; i <= k; i++) {
+            result = result * (n - k + i) / i;
+        }
+        return result;
+    }
+
+    static constexpr int NUM_ROLLS = binomial(SIDES + DICE - 1, DICE);
+    static_assert(NUM_CLAIMS + 8 <= 64 && NUM_ROLLS <= 256, "infoset key must fit in 64 bits");
+
+    using Roll = std::array<int, DICE>;
+
+    // Rank of a sorted roll (faces 0 .. SIDES - 1) in the combinatorial number system:
+    // the nondecreasing faces d[i] become the strictly increasing d[i] + i.
+    static constexpr int rollIndex(const Roll& sorted) {
+        int index = 0;
+        for (int i = 0; i < DICE; i++) {
+            index += binomial(sorted[i] + i, i + 1);
+        }
+        return index;
+    }
+
+    struct Tables {
+        std::array<int, NUM_CLAIMS> claimNum{};
+        std::array<int, NUM_CLAIMS> claimRank{};
+        // faceCount[rollIndex][face - 1]: dice of the roll showing face
+        std::array<std::array<int, SIDES>, NUM_ROLLS> faceCount{};
+    };
+
+    static constexpr Tables makeTables() {
+        Tables t;
+        for (int c = 0; c < NUM_CLAIMS; c++) {
+            t.claimNum[c] = c / SIDES + 1;
+            t.claimRank[c] = (c % SIDES == SIDES - 1) ? 1 : c % SIDES + 2;
+        }
+        // Visit every sorted roll like an odometer whose digits never decrease
+        Roll roll{};
+        while (true) {
+            int index = rollIndex(roll);
+            for (int i = 0; i < DICE; i++) {
+                t.faceCount[index][roll[i]]++;
+            }
+            int i = DICE - 1;
+            while (i >= 0 && roll[i] == SIDES - 1) i--;
+            if (i < 0) break;
+            roll[i]++;
+            for (int j = i + 1; j < DICE; j++) {
+                roll[j] = roll[i];
+            }
+        }
+        return t;
+    }
+
+    static constexpr Tables tables = makeTables();
+
+    static uint64_t infoSetToInteger(int rollIndex, uint64_t isClaimed) {
+        return ((uint64_t) rollIndex << NUM_CLAIMS) | isClaimed;
+    }
+
+    // Utility for the player who made lastClaim when the opponent calls DUDO on it
+    static double dudoUtility(const int* rolls, int lastClaim) {
+        int rank = tables.claimRank[lastClaim];
+        int count = tables.claimNum[lastClaim];
+        for (int p = 0; p < 2; p++) {
+            count -= tables.faceCount[rolls[p]][rank - 1];
+            if (rank != 1) count -= tables.faceCount[rolls[p]][0];
+        }
+        return (count <= 0) ? 1.0 : -1.0;
+    }
+
+    // dudoUtility for every claim and pair of roll indices, built from the face count
+    // histograms when the game is constructed: row c holds claim c's payoffs to the claimer,
+    // entry r0 * NUM_ROLLS + r1 for rolls r0 and r1, so a terminal is one load and range
+    // evaluators can take a claim's whole row
+    std::vector<double> claimPayoff;
+
+    MultiDudoGame() : claimPayoff((size_t) NUM_CLAIMS * NUM_ROLLS * NUM_ROLLS) {
+        for (int c = 0; c < NUM_CLAIMS; c++) {
+            double* row = &claimPayoff[(size_t) c * NUM_ROLLS * NUM_ROLLS];
+            for (int r0 = 0; r0 < NUM_ROLLS; r0++) {
+                for (int r1 = 0; r1 < NUM_ROLLS; r1++) {
+                    int rolls[2] = {r0, r1};
+                    row[r0 * NUM_ROLLS + r1] = dudoUtility(rolls, c);
+                }
+            }
+        }
+    }
+
+    const double* payoffRow(int claim) const {
+        return &claimPayoff[(size_t) claim * NUM_ROLLS * NUM_ROLLS];
+    }
+
+    struct State {
+        int rolls[2] = {-1, -1};   // roll indices, -1 until dealt
+        uint64_t history = 0;      // claim mask
+        int plays = 0;
+        int lastClaim = -1;
+        bool doubted = false;      // DUDO was called on lastClaim
+    };
+
+    State root() const {
+        return State{};
+    }
+
+    bool isTerminal(const State& state) const {
+        return state.doubted;
+    }
+
+    // The player who called DUDO moved at plays - 1, the claimer before that
+    double utility(const State& state, int player) const {
+        int claimer = state.plays % 2;
+        double claimerUtil = payoffRow(state.lastClaim)[state.rolls[0] * NUM_ROLLS + state.rolls[1]];
+        return (player == claimer) ? claimerUtil : -claimerUtil;
+    }
+
+    bool isChance(const State& state) const {
+        return state.rolls[0] < 0;
+    }
+
+    State sampleChance(const State& state, cfr::Philox& gen) const {
+        State next = state;
+        for (int p = 0; p < 2; p++) {
+            Roll roll;
+            for (int d = 0; d < DICE; d++) {
+                roll[d] = gen.below(SIDES);
+            }
+            std::sort(roll.begin(), roll.end());
+            next.rolls[p] = rollIndex(roll);
+        }
+        return next;
+    }
+
+    int player(const State& state) const {
+        return state.plays % 2;
+    }
+
+    // Action a is claim lastClaim + 1 + a, or DUDO once a claim has been made
+    int numActions(const State& state) const {
+        return (state.plays > 0 ? NUM_ACTIONS : NUM_CLAIMS) - (state.lastClaim + 1);
+    }
+
+    uint64_t infoSetKey(const State& state) const {
+        return infoSetToInteger(state.rolls[player(state)], state.history);
+    }
+
+    State play(const State& state, int a) const {
+        int action = state.lastClaim + 1 + a;
+        State next = state;
+        next.plays++;
+        if (action == DUDO) {
+            next.doubted = true;
+        }
+        else {
+            next.history |= 1ULL << action;
+            next.lastClaim = action;
+        }
+        return next;
+    }
+};
+
+// Train, and write the average strategies to policyPath unless it is empty. Policies are
+// keyed by MultiDudoGame::infoSetToInteger and tagged DudoNdS.
+template <int DICE, int SIDES, class Value>
+bool trainMultiDudo(int iterations, const std::string& policyPath) {
+    cfr::ExternalSamplingTrainer<MultiDudoGame<DICE, SIDES>, Value> trainer;
+    double util = trainer.train(iterations);
+    std::cout << "Final average game value: " << util << "\n";
+    std::cout << trainer.numNodes() << " information sets, " << cfr::storageName<Value>() << " values, "
+              << trainer.memoryUsage() / 1024 << " KB\n";
+
+    if (policyPath.empty()) {
+        return true;
+    }
+    return trainer.exportPolicy(policyPath, "Dudo" + std::to_string(DICE) + "d" + std::to_string(SIDES));
+}
+
+// Train with the table values stored as storage: float64, float32, int32 or int16
+template <int DICE, int SIDES>
+bool trainMultiDudo(int iterations, const std::string& storage, const std::string& policyPath) {
+    if (storage == "float64") return trainMultiDudo<DICE, SIDES, double>(iterations, policyPath);
+    if (storage == "float32") return trainMultiDudo<DICE, SIDES, float>(iterations, policyPath);
+    if (storage == "int32") return trainMultiDudo<DICE, SIDES, cfr::Int32Value>(iterations, policyPath);
+    if (storage == "int16") return trainMultiDudo<DICE, SIDES, cfr::Int16Value>(iterations, policyPath);
+    std::cerr << "Unknown storage " << storage << "\n";
+    return false;
+}
+
+// Micro-benchmarks of the one-die trainer's hot paths, then the training throughput of each
+// mode, of the parallel trainer on 2, 4 and 8 threads, and of two-dice external sampling
+// from the benchmark seed
+int runBenchmarks(const bench::Options& options) {
+    bench::Suite suite(options);
+
+    // Mixed-sign regrets, so regret matching takes both of its branches
     DudoTrainer trainer;
-    trainer.train(10000);
+    std::mt19937 gen(options.seed);
+    std::uniform_real_distribution<double> regret(-1.0, 1.0);
+    for (double& r : trainer.regretSum) {
+        r = regret(gen);
+    }
+    // Sampled deals and claims for the terminal evaluation
+    const int NUM_DEALS = 4096;
+    std::vector<std::array<int, 3>> deals(NUM_DEALS);
+    std::uniform_int_distribution<int> die(1, DudoTrainer::NUM_SIDES);
+    std::uniform_int_distribution<int> claim(0, DudoTrainer::DUDO - 1);
+    for (auto& deal : deals) {
+        deal = {die(gen), die(gen), claim(gen)};
+    }
+
+    // Includes the getNode lookup that precedes it in cfr
+    double strategy[DudoTrainer::NUM_ACTIONS];
+    suite.micro("Dudo.getStrategy", 2000000, [&](long i) {
+        DudoTrainer::Node node = trainer.getNode(i % DudoTrainer::NUM_INFO_SETS + DudoTrainer::NUM_HISTORIES);
+        node.getStrategy(strategy, 0.5);
+        bench::doNotOptimize(strategy[0]);
+    });
+    suite.micro("Dudo.infoSetToInteger", 20000000, [&](long i) {
+        bench::doNotOptimize(trainer.infoSetToInteger(deals[i % NUM_DEALS][0], i & (DudoTrainer::NUM_HISTORIES - 1)));
+    });
+    suite.micro("Dudo.claimHistoryToString", 500000, [&](long i) {
+        bench::doNotOptimize(trainer.claimHistoryToString(i & (DudoTrainer::NUM_HISTORIES - 1)).size());
+    });
+    suite.micro("Dudo.dudoUtility", 20000000, [&](long i) {
+        const auto& deal = deals[i % NUM_DEALS];
+        bench::doNotOptimize(trainer.dudoUtility(deal.data(), deal[2]));
+    });
+    suite.micro("Dudo.claimerPayoff", 20000000, [&](long i) {
+        const auto& deal = deals[i % NUM_DEALS];
+        bench::doNotOptimize(trainer.claimerPayoff(deal.data(), deal[2]));
+    });
+
+    auto train = [](auto configure) {
+        return [configure](long iterations) {
+            DudoTrainer trainer;
+            trainer.printEvery = 0;
+            trainer.printSummary = false;
+            configure(trainer, iterations);
+            return trainer.nodesTouched;
+        };
+    };
+    suite.macro("Dudo.cfr", 2000, train([](DudoTrainer& t, long n) {
+        t.train(n);
+    }));
+    suite.macro("Dudo.cfr.prune", 2000, train([](DudoTrainer& t, long n) {
+        t.pruning = true;
+        t.train(n);
+    }));
+    suite.macro("Dudo.cfr.alternating", 2000, train([](DudoTrainer& t, long n) {
+        t.alternating = true;
+        t.train(n);
+    }));
+    // Deals/s against thread count; on fewer cores than threads this measures the merge and
+    // barrier overhead instead of the speedup
+    for (int threads : {2, 4, 8}) {
+        suite.macro("Dudo.parallel" + std::to_string(threads), 2000, train([threads](DudoTrainer& t, long n) {
+            t.trainParallel(n, threads);
+        }));
+    }
+    suite.macro("Dudo.vector", 200, train([](DudoTrainer& t, long n) {
+        t.trainVector(n);
+    }));
+    suite.macro("Dudo.external", 50000, train([](DudoTrainer& t, long n) {
+        t.discountEvery = 1000;
+        t.trainMonteCarlo(n, DudoTrainer::Sampling::External);
+    }));
+    suite.macro("Dudo.outcome", 500000, train([](DudoTrainer& t, long n) {
+        t.discountEvery = 1000;
+        t.trainMonteCarlo(n, DudoTrainer::Sampling::Outcome);
+    }));
+    suite.macro("Dudo2d4.external", 10000, [](long iterations) {
+        cfr::ExternalSamplingTrainer<MultiDudoGame<2, 4>> trainer;
+        trainer.train(iterations, 0);
+        return trainer.nodesTouched;
+    });
+
+    return suite.finish();
+}
+
+
+// Command line summary, printed with usage errors
+static const char* USAGE =
+    "Usage: Dudo [iterations] [--threads N (0 = all cores)] [--merge-every deals-per-thread] [--vector]\n"
+    "            [--rule vanilla|cfr+|linear|dcfr] [--alpha A] [--beta B] [--gamma G]\n"
+    "            [--sampling external|outcome] [--epsilon E] [--discount-every N]\n"
+    "            [--prune] [--prune-threshold T] [--prune-recheck N] [--alternating]\n"
+    "            [--eval-every N] [--print-every N] [--seed S]\n"
+    "            [--telemetry file|- [--telemetry-every seconds]]   (builds with -DCFR_TELEMETRY=1)\n"
+    "            [--load checkpoint] [--save checkpoint] [--export-policy table]\n"
+    "       Dudo [iterations] --dice 1|2|3 [--sides 4|6]   (multi-dice, external sampling)\n"
+    "            [--storage float64|float32|int32|int16]\n"
+    "       Dudo --bench [--baseline file] [--save-baseline file] [--tolerance percent]\n"
+    "            [--repeats R] [--bench-scale X]\n";
+
+// Report a bad command line, returning the exit status for it
+int usageError(const std::string& message) {
+    std::cerr << message << "\n" << USAGE;
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = 10000;
+    int numThreads = 1;
+    bool vector = false;
+    std::string sampling;
+    int discountEvery = 0;
+    bool pruneThresholdSet = false;
+    std::string loadPath;
+    std::string savePath;
+    std::string policyPath;
+    int dice = 1;
+    int sides = DudoTrainer::NUM_SIDES;
+    std::string storage;
+    std::string telemetryPath;
+    double telemetryEvery = 1.0;
+    bench::Options benchOptions;
+    DudoTrainer trainer;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (bench::parseArgument(benchOptions, argc, argv, i)) {
+                continue;
+            }
+            else if (arg == "--threads" && i + 1 < argc) {
+                numThreads = std::stoi(argv[++i]);
+                if (numThreads <= 0) {
+                    numThreads = std::max(1u, std::thread::hardware_concurrency());
+                }
+            }
+            else if (arg == "--merge-every" && i + 1 < argc) {
+                trainer.mergeEvery = std::max(1, std::stoi(argv[++i]));
+            }
+            else if (arg == "--dice" && i + 1 < argc) {
+                dice = std::stoi(argv[++i]);
+            }
+            else if (arg == "--sides" && i + 1 < argc) {
+                sides = std::stoi(argv[++i]);
+            }
+            else if (arg == "--storage" && i + 1 < argc) {
+                storage = argv[++i];
+            }
+            else if (arg == "--vector") {
+                vector = true;
+            }
+            else if (arg == "--sampling" && i + 1 < argc) {
+                sampling = argv[++i];
+                if (sampling != "external" && sampling != "outcome") {
+                    return usageError("Unknown sampling " + sampling);
+                }
+            }
+            else if (arg == "--epsilon" && i + 1 < argc) {
+                trainer.epsilon = std::stod(argv[++i]);
+            }
+            else if (arg == "--discount-every" && i + 1 < argc) {
+                discountEvery = std::stoi(argv[++i]);
+            }
+            else if (arg == "--rule" && i + 1 < argc) {
+                std::string rule = argv[++i];
+                if (rule == "cfr+") trainer.updateRule = DudoTrainer::UpdateRule::CFRPlus;
+                else if (rule == "linear") trainer.updateRule = DudoTrainer::UpdateRule::Linear;
+                else if (rule == "dcfr") trainer.updateRule = DudoTrainer::UpdateRule::Discounted;
+                else if (rule == "vanilla") trainer.updateRule = DudoTrainer::UpdateRule::Vanilla;
+                else return usageError("Unknown update rule " + rule);
+            }
+            else if (arg == "--alpha" && i + 1 < argc) {
+                trainer.alpha = std::stod(argv[++i]);
+            }
+            else if (arg == "--beta" && i + 1 < argc) {
+                trainer.beta = std::stod(argv[++i]);
+            }
+            else if (arg == "--gamma" && i + 1 < argc) {
+                trainer.gamma = std::stod(argv[++i]);
+            }
+            else if (arg == "--prune") {
+                trainer.pruning = true;
+            }
+            else if (arg == "--prune-threshold" && i + 1 < argc) {
+                trainer.pruneThreshold = std::stod(argv[++i]);
+                pruneThresholdSet = true;
+            }
+            else if (arg == "--prune-recheck" && i + 1 < argc) {
+                trainer.pruneRecheckEvery = std::stoi(argv[++i]);
+                if (trainer.pruneRecheckEvery <= 0) {
+                    return usageError("--prune-recheck takes a positive number of iterations");
+                }
+            }
+            else if (arg == "--alternating") {
+                trainer.alternating = true;
+            }
+            else if (arg == "--eval-every" && i + 1 < argc) {
+                trainer.evalEvery = std::stoi(argv[++i]);
+            }
+            else if (arg == "--print-every" && i + 1 < argc) {
+                trainer.printEvery = std::stoi(argv[++i]);
+            }
+            else if (arg == "--seed" && i + 1 < argc) {
+                cfr::seedGenerators(std::stoull(argv[++i]));
+            }
+            else if (arg == "--telemetry" && i + 1 < argc) {
+                telemetryPath = argv[++i];
+            }
+            else if (arg == "--telemetry-every" && i + 1 < argc) {
+                telemetryEvery = std::stod(argv[++i]);
+            }
+            else if (arg == "--load" && i + 1 < argc) {
+                loadPath = argv[++i];
+            }
+            else if (arg == "--save" && i + 1 < argc) {
+                savePath = argv[++i];
+            }
+            else if (arg == "--export-policy" && i + 1 < argc) {
+                policyPath = argv[++i];
+            }
+            else if (!arg.empty() && arg.find_first_not_of("0123456789") == std::string::npos) {
+                iterations = std::stoi(arg);
+            }
+            else {
+                return usageError("Unknown argument " + arg);
+            }
+        }
+    }
+    catch (const std::logic_error&) {
+        // A number that std::stoi and friends couldn't read
+        return usageError("Malformed number in arguments");
+    }
+
+    if (benchOptions.enabled) {
+        return runBenchmarks(benchOptions);
+    }
+
+    std::string program = "Dudo";
+    if (dice != 1 || sides != DudoTrainer::NUM_SIDES) {
+        program += std::to_string(dice) + "d" + std::to_string(sides);
+    }
+    if (!telemetryPath.empty() && !telemetry::open(telemetryPath, program, telemetryEvery)) {
+        return 1;
+    }
+
+    // Variants other than one six-sided die each are compiled for a fixed set of sizes
+    if (dice != 1 || sides != DudoTrainer::NUM_SIDES) {
+        // They train through the generic external-sampling driver, which has no update rules,
+        // pruning, threads or checkpoints
+        if (!loadPath.empty() || !savePath.empty() || trainer.updateRule != DudoTrainer::UpdateRule::Vanilla
+            || trainer.pruning || trainer.alternating || numThreads > 1 || vector
+            || (!sampling.empty() && sampling != "external") || discountEvery > 0 || trainer.evalEvery > 0) {
+            std::cerr << "--dice and --sides train with external sampling only and don't take --load, --save, "
+                         "--rule, --prune, --alternating, --threads, --vector, --sampling outcome, "
+                         "--discount-every or --eval-every\n";
+            return 1;
+        }
+        if (storage.empty()) storage = "float64";
+        bool trained;
+        if (dice == 1 && sides == 4) trained = trainMultiDudo<1, 4>(iterations, storage, policyPath);
+        else if (dice == 2 && sides == 4) trained = trainMultiDudo<2, 4>(iterations, storage, policyPath);
+        else if (dice == 2 && sides == 6) trained = trainMultiDudo<2, 6>(iterations, storage, policyPath);
+        else if (dice == 3 && sides == 4) trained = trainMultiDudo<3, 4>(iterations, storage, policyPath);
+        else if (dice == 3 && sides == 6) trained = trainMultiDudo<3, 6>(iterations, storage, policyPath);
+        else {
+            std::cerr << "No Dudo variant compiled for " << dice << " dice with " << sides << " sides\n";
+            return 1;
+        }
+        return trained ? 0 : 1;
+    }
+
+    // The one-die table is 24576 information sets and already fits in cache as doubles
+    if (!storage.empty()) {
+        std::cerr << "--storage applies to the multi-dice variants\n";
+        return 1;
+    }
+
+    if (trainer.alternating && (vector || !sampling.empty() || numThreads > 1)) {
+        std::cerr << "--alternating applies to single-threaded chance-sampled CFR\n";
+        return 1;
+    }
+
+    // Only chance-sampled CFR has a threaded trainer
+    if (numThreads > 1 && (vector || !sampling.empty())) {
+        std::cerr << "--threads can't be combined with --vector or --sampling\n";
+        return 1;
+    }
+
+    // Sampled iterations touch a single path or slice, so discount per block of them by default
+    if (discountEvery > 0) {
+        trainer.discountEvery = discountEvery;
+    }
+    else if (!sampling.empty()) {
+        trainer.discountEvery = 1000;
+    }
+    // Sampled regrets carry no reach weight and grow much faster. At 200k iterations of
+    // external sampling -1000 prunes a third of the edges considered, at no loss.
+    if (!pruneThresholdSet && !sampling.empty()) {
+        trainer.pruneThreshold = -1000.0;
+    }
+
+    if (!loadPath.empty() && !trainer.loadCheckpoint(loadPath)) {
+        return 1;
+    }
+
+    if (vector) {
+        trainer.trainVector(iterations);
+    }
+    else if (sampling == "external") {
+        trainer.trainMonteCarlo(iterations, DudoTrainer::Sampling::External);
+    }
+    else if (sampling == "outcome") {
+        trainer.trainMonteCarlo(iterations, DudoTrainer::Sampling::Outcome);
+    }
+    else if (numThreads > 1) {
+        trainer.trainParallel(iterations, numThreads);
+    }
+    else {
+        trainer.train(iterations);
+    }
+
+    if (!savePath.empty() && !trainer.saveCheckpoint(savePath)) {
+        return 1;
+    }
+    if (!policyPath.empty() && !trainer.exportPolicy(policyPath)) {
+        return 1;
+    }
     return 0;
 }
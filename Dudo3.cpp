@@ -1,119 +1,170 @@
 #include <iostream>
 #include <vector>
-#include <unordered_map>
 #include <string>
 #include <random>
 #include <algorithm>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
+#include <array>
 
-class Node {
-public:
-    // min, max are inclusive
-    int minAction;
-    int maxAction;
-    int numActions;
-    std::string infoSet;
+#include "Checkpoint.h"
+#include "CFR.h"
+#include "Policy.h"
+#include "Bench.h"
 
-    std::vector<double> regretSum;
-    std::vector<double> strategy;
-    std::vector<double> strategySum;
-
-    bool processed = false;
-    bool backProcessed = false;
-
-    // utility value for each node
-    double u = 0.0;
-    // realization weights
-    double pPlayer = 0.0;
-    double pOpponent = 0.0;
-
-    Node(int minA, int maxA)
-        : minAction(minA),
-            maxAction(maxA),
-            numActions(maxA - minA + 1),
-            regretSum(numActions, 0.0),
-            strategy(numActions, 0.0),
-            strategySum(numActions, 0.0) {}
-
-    Node(std::string infoSetStr, int minA, int maxA)
-        : minAction(minA),
-            maxAction(maxA),
-            numActions(maxA - minA + 1),
-            infoSet(infoSetStr),
-            regretSum(numActions, 0.0),
-            strategy(numActions, 0.0),
-            strategySum(numActions, 0.0) {}
-
-    const std::vector<double>& getStrategy() {
-        double normalizingSum = 0.0;
-
-        for (int i = 0; i < numActions; i++) {
-            strategy[i] = std::max(regretSum[i], 0.0);
-            normalizingSum += strategy[i];
+// Imperfect-recall Dudo trainer where players remember only their MEMORY most recent claims
+template<int MEMORY = 3>
+class Dudo3Trainer : public cfr::NodeStore<> {
+public:
+    // Dudo definitions
+    static const int NUM_SIDES = 6;
+    static const int NUM_ACTIONS = (2 * NUM_SIDES) + 1;
+    static const int DUDO = NUM_ACTIONS - 1;
+    static_assert(MEMORY >= 1 && MEMORY <= DUDO, "claim memory must be 1..12");
+
+    static constexpr int binomial(int n, int k) {
+        if (k < 0 || k > n) return 0;
+        int result = 1;
+        for (int i = 1; i <= k; i++) {
+            result = result * (n - k + i) / i;
         }
+        return result;
+    }
 
-        for (int i = 0; i < numActions; i++) {
-            if (normalizingSum > 0) {
-                strategy[i] /= normalizingSum;
-            }
-            else {
-                strategy[i] = 1.0 / numActions;
+    // Number of claim sets of at most MEMORY claims
+    static constexpr int numClaimSets() {
+        int count = 0;
+        for (int k = 0; k <= MEMORY; k++) {
+            count += binomial(DUDO, k);
+        }
+        return count;
+    }
+    static const int NUM_CLAIM_SETS = numClaimSets();
+
+    // Dense index of a claim set: sets are ordered by size, then colexicographically via the
+    // combinatorial number system. This is also a topological order, since a claim is always
+    // higher than every claim remembered before it.
+    static constexpr int rankClaimSet(int isClaimed) {
+        int k = __builtin_popcount(isClaimed);
+        int rank = 0;
+        for (int j = 0; j < k; j++) {
+            rank += binomial(DUDO, j);
+        }
+        int i = 1;
+        for (int a = 0; a < DUDO; a++) {
+            if ((isClaimed >> a) & 1) {
+                rank += binomial(a, i++);
             }
-            strategySum[i] += pPlayer * strategy[i];
         }
+        return rank;
+    }
+
+    std::vector<int> claimNum{1,1,1,1,1,1,2,2,2,2,2,2};
+    std::vector<int> claimRank{2,3,4,5,6,1,2,3,4,5,6,1};
 
-        return strategy;
+    // Claim mask of each claim set, by rankClaimSet
+    std::vector<int> claimSets;
+    // Most recent claim of each set (-1 for the empty set)
+    std::vector<int> lastClaim;
+    // Bit p is set if player p can be the one to act remembering the set
+    std::vector<uint8_t> actors;
+    // Claim set reached by claiming action a from set s is
+    // successors[successorBegin[s] + a - lastClaim[s] - 1]
+    std::vector<int> successorBegin;
+    std::vector<int> successors;
+
+    // The node store has one node per information set, node (roll - 1) * NUM_CLAIM_SETS + s,
+    // with a value per legal action from lastClaim[s] + 1 on. strategy is laid out like
+    // regretSum and strategySum.
+    static const int NUM_NODES = NUM_SIDES * NUM_CLAIM_SETS;
+    std::vector<double> strategy;
+    // Realization weights and utility of each node in the current sweep
+    std::vector<double> pPlayer;
+    std::vector<double> pOpponent;
+    std::vector<double> u;
+
+    // Training iterations completed so far, carried across checkpoints
+    int iteration = 0;
+
+    // Regret-based pruning: don't propagate weights along an action the current strategy
+    // doesn't play and whose regret is below pruneThreshold. One deal in every
+    // pruneRecheckEvery (in trainBatched, the batch holding it) sweeps every edge, and scales
+    // the regret update of each prunable edge by the deals that skipped it.
+    bool pruning = false;
+    double pruneThreshold = -20.0;
+    int pruneRecheckEvery = 20;
+    // Whether the current iteration prunes, set at the start of each iteration, and the
+    // weight of prunable edges' regret updates when it doesn't
+    bool pruneActive = false;
+    double recheckWeight = 1.0;
+
+    // Action edges between nodes that were considered and skipped
+    uint64_t edgesVisited = 0;
+    uint64_t edgesPruned = 0;
+
+    // Print progress every printEvery iterations, off (0) unless asked for since telemetry
+    // tracks long sweeps; write output.txt and the final values after training unless
+    // printSummary is off
+    int printEvery = 0;
+    bool printSummary = true;
+
+    // Nodes swept with nonzero reach, counted per deal (per lane in trainBatched), for benchmarks
+    uint64_t nodesTouched = 0;
+
+    // Whether the edge of action value v is skipped unless this is a recheck
+    bool prunable(int v) const {
+        return pruning && strategy[v] == 0.0 && regretSum[v] < pruneThreshold;
     }
 
-    std::vector<double> getAverageStrategy() const {
-        std::vector<double> avg(numActions);
-        double normalizingSum = 0.0;
+    // Whether the edge of action value v is skipped this iteration
+    bool isPruned(int v) const {
+        return pruneActive && prunable(v);
+    }
 
-        for (int i = 0; i < numActions; i++) {
-            normalizingSum += strategySum[i];
-        }
-        for (int i = 0; i < numActions; i++) {
-            if (normalizingSum > 0) {
-                avg[i] = strategySum[i] / normalizingSum;
-            }
-            else {
-                avg[i] = 1.0 / numActions;
-            }
-        }
-        return avg;
+    // Weight of this iteration's regret update for the edge of action value v
+    double regretWeight(int v) const {
+        if (!prunable(v)) return 1.0;
+        return pruneActive ? 0.0 : recheckWeight;
     }
 
-    std::string toString() const {
+    int numActions(int i) const {
+        return offset[i + 1] - offset[i];
+    }
+
+    // Regret-match node i into strategy without accumulating it into strategySum
+    void regretMatch(int i) {
+        cfr::regretMatch(&regretSum[offset[i]], &strategy[offset[i]], numActions(i));
+    }
+
+    // Regret-match node i, adding the strategy weighted by its pPlayer into strategySum
+    void getStrategy(int i) {
+        int begin = offset[i];
+        cfr::regretMatchAccumulate(&regretSum[begin], &strategy[begin], &strategySum[begin], numActions(i), pPlayer[i]);
+    }
+
+    std::vector<double> getAverageStrategy(int i) const {
+        return cfr::averageStrategy(&strategySum[offset[i]], numActions(i));
+    }
+
+    // Readable label of node i, e.g. "3 1*2,1*5: [...]", built only for output
+    std::string nodeToString(int i) const {
         std::ostringstream out;
-        out << infoSet << ": [";
-        auto avg = getAverageStrategy();
-        for (size_t i = 0; i < avg.size(); i++) {
-            out << std::setw(4) << std::fixed << std::setprecision(5) << avg[i];
-            if (i + 1 < avg.size()) out << " ";
+        out << std::to_string(i / NUM_CLAIM_SETS + 1) + claimHistoryToString(claimSets[i % NUM_CLAIM_SETS]) << ": [";
+        auto avg = getAverageStrategy(i);
+        for (size_t a = 0; a < avg.size(); a++) {
+            out << std::setw(4) << std::fixed << std::setprecision(5) << avg[a];
+            if (a + 1 < avg.size()) out << " ";
         }
         out << "]";
         return out.str();
     }
-};
-
-class Dudo3Trainer {
-public:
-    // Dudo definitions
-    const int NUM_SIDES = 6;
-    const int NUM_ACTIONS = (2 * NUM_SIDES) + 1;
-    const int DUDO = NUM_ACTIONS - 1;
-
-    std::vector<int> claimNum{1,1,1,1,1,1,2,2,2,2,2,2};
-    std::vector<int> claimRank{2,3,4,5,6,1,2,3,4,5,6,1};
-
-    std::unordered_map<uint64_t, Node> nodeMap;
 
-    // Convert Dudo claim history to a string
-    std::string claimHistoryToString(const std::vector<bool>& isClaimed) const {
+    // Convert Dudo claim history (bit a set if claim a was made) to a string
+    std::string claimHistoryToString(int isClaimed) const {
         std::string s;
         for (int a = 0; a < DUDO; a++) {
-            if (isClaimed[a]) {
+            if ((isClaimed >> a) & 1) {
                 if (!s.empty()) s += ",";
                 s += std::to_string(claimNum[a]) + "*" + std::to_string(claimRank[a]);
             }
@@ -122,339 +173,669 @@ public:
     }
 
     // Convert Dudo information set to an integer
-    uint64_t infoSetToInteger(int playerRoll, const std::vector<bool>& isClaimed) const {
-        uint64_t infoSetNum = playerRoll;
-        for (int a = NUM_ACTIONS - 2; a >= 0; a--) {
-            infoSetNum = (infoSetNum << 1) | (isClaimed[a] ? 1 : 0);
+    uint64_t infoSetToInteger(int playerRoll, int isClaimed) const {
+        return ((uint64_t) playerRoll << DUDO) | isClaimed;
+    }
+
+    // Claims remembered after claiming action: the oldest, i.e. lowest, claim is forgotten
+    static int rememberClaim(int isClaimed, int action) {
+        isClaimed |= 1 << action;
+        if (__builtin_popcount(isClaimed) > MEMORY) {
+            isClaimed &= isClaimed - 1;
         }
-        return infoSetNum;
-    }
-
-    // Constructs the trainer and allocates all possible nodes with memory of at most 3 claims
-    Dudo3Trainer() {
-        std::vector<bool> isClaimed(NUM_ACTIONS-1, false);
-        // Possible dice ranks for each information set 
-        for (int i = 1; i <= NUM_SIDES; i++) {
-            // No claims in history (i.e. starting node)
-            std::string infoSetStr = std::to_string(i) + claimHistoryToString(isClaimed);
-            nodeMap.emplace(infoSetToInteger(i, isClaimed), Node(infoSetStr, 0, DUDO-1));
-            // 1 claim in history
-            for (int a = 0; a < NUM_ACTIONS-1; a++) {
-                isClaimed[a] = true;
-                std::string infoSetStr = std::to_string(i) + claimHistoryToString(isClaimed);
-                nodeMap.emplace(infoSetToInteger(i, isClaimed), Node(infoSetStr, a+1, DUDO));
-                // 2 claims in history
-                for (int b = a+1; b < NUM_ACTIONS-1; b++) {
-                    isClaimed[b] = true;
-                    std::string infoSetStr = std::to_string(i) + claimHistoryToString(isClaimed);
-                    nodeMap.emplace(infoSetToInteger(i, isClaimed), Node(infoSetStr, b+1, DUDO));
-                    // 3 claims in history
-                    for (int c = b+1; c < NUM_ACTIONS-1; c++) {
-                        isClaimed[c] = true;
-                        std::string infoSetStr = std::to_string(i) + claimHistoryToString(isClaimed);
-                        nodeMap.emplace(infoSetToInteger(i, isClaimed), Node(infoSetStr, c+1, DUDO));
-                        isClaimed[c] = false;
-                    }
-                    isClaimed[b] = false;
-                }
-                isClaimed[a] = false;
+        return isClaimed;
+    }
+
+    // Constructs the trainer, ranking every claim set of at most MEMORY claims and allocating
+    // a node per set and roll along with the successor table
+    Dudo3Trainer() : claimSets(NUM_CLAIM_SETS),
+                     pPlayer(NUM_NODES, 0.0), pOpponent(NUM_NODES, 0.0), u(NUM_NODES, 0.0) {
+        for (int mask = 0; mask < (1 << DUDO); mask++) {
+            if (__builtin_popcount(mask) <= MEMORY) {
+                claimSets[rankClaimSet(mask)] = mask;
             }
         }
-        
+        auto highestClaim = [](int mask) { return mask == 0 ? -1 : 31 - __builtin_clz(mask); };
+
+        int numSets = NUM_CLAIM_SETS;
+
+        for (int s = 0; s < numSets; s++) {
+            int mask = claimSets[s];
+            int claims = __builtin_popcount(mask);
+            lastClaim.push_back(highestClaim(mask));
+            // With fewer than MEMORY claims the whole history is known. With MEMORY claims
+            // they may be the first MEMORY claims, or follow forgotten claims, which needs a
+            // claim below them, so claim 0 can't be among them.
+            if (claims < MEMORY || (mask & 1)) {
+                actors.push_back(1 << (claims % 2));
+            }
+            else {
+                actors.push_back(3);
+            }
+            successorBegin.push_back(successors.size());
+            for (int a = lastClaim[s] + 1; a < DUDO; a++) {
+                successors.push_back(rankClaimSet(rememberClaim(mask, a)));
+            }
+        }
+
+        for (int i = 0; i < NUM_NODES; i++) {
+            int s = i % numSets;
+            // DUDO can't be called before any claim has been made
+            addNode(nodeKey(i), ((claimSets[s] != 0) ? DUDO : DUDO - 1) - lastClaim[s]);
+        }
+        strategy.assign(regretSum.size(), 0.0);
+    }
+
+    // Bytes used by the node store and the claim set tables
+    size_t memoryUsage() const {
+        return storeBytes()
+               + (claimSets.size() + lastClaim.size() + successorBegin.size() + successors.size()) * sizeof(int)
+               + actors.size()
+               + (strategy.size() + 3 * NUM_NODES) * sizeof(double);
+    }
+
+    // Checkpoint game tag, so checkpoints of different memory depths can't be mixed up
+    static std::string gameTag() {
+        return "DudoRecall" + std::to_string(MEMORY);
+    }
+
+    // Key of node i, infoSetToInteger of its roll and claim set
+    uint64_t nodeKey(int i) const {
+        return infoSetToInteger(i / NUM_CLAIM_SETS + 1, claimSets[i % NUM_CLAIM_SETS]);
+    }
+
+    // Save every node's regret and strategy sums, keyed by infoSetToInteger, to a binary checkpoint
+    bool saveCheckpoint(const std::string& path) const {
+        return NodeStore::saveCheckpoint(path, gameTag(), iteration);
+    }
+
+    // Write the average strategies as a policy table keyed by infoSetToInteger
+    bool exportPolicy(const std::string& path) const {
+        return NodeStore::exportPolicy(path, gameTag());
+    }
+
+    // Resume from a checkpoint written by saveCheckpoint
+    bool loadCheckpoint(const std::string& path) {
+        return NodeStore::loadCheckpoint(path, gameTag(), iteration);
+    }
+
+    // Utility for the player who made lastClaim when the opponent calls DUDO on it
+    double dudoUtility(const int* rolls, int lastClaim) const {
+        int count = claimNum[lastClaim];
+        int rank = claimRank[lastClaim];
+
+        for (int i = 0; i < 2; i++) {
+            if (rolls[i] == 1 || rolls[i] == rank) count--;
+        }
+
+        return (count <= 0) ? 1.0 : -1.0;
+    }
+
+    // Whether player p acts on claim set s in this deal as a node of its own. With equal
+    // rolls both players' states on a set share one node, which is visited once.
+    bool visits(int p, int s, const int* rolls) const {
+        if (!((actors[s] >> p) & 1)) return false;
+        return !(p == 1 && rolls[0] == rolls[1] && (actors[s] & 1));
+    }
+
+    // Rolls of deal number deal, drawn from its Philox stream under key
+    static void dealRolls(uint64_t key, uint64_t deal, int* rolls) {
+        cfr::Philox gen(key, deal);
+        rolls[0] = 1 + gen.below(NUM_SIDES);
+        rolls[1] = 1 + gen.below(NUM_SIDES);
     }
 
+    // Train with FSICFR. Each iteration samples the rolls of deal iter and sweeps the node
+    // graph forward in topological order to accumulate realization weights, then backward to
+    // compute utilities and regrets.
     void train(int iterations) {
         double gameValSum = 0.0;
+        int numSets = claimSets.size();
 
-        std::vector<double> regret(NUM_SIDES);
+        uint64_t key = cfr::makeStreamKey();
 
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<int> die(1, 6);
+        // A resumed run keeps the strategy sums it was loaded with
+        bool resumed = iteration > 0;
 
         for (int iter = 0; iter < iterations; iter++) {
+            CFR_TELEMETRY_PHASE(Sample);
+            int rolls[2];
+            dealRolls(key, iter, rolls);
+            // First node of each player's roll
+            int rollBase[2] = {(rolls[0] - 1) * numSets, (rolls[1] - 1) * numSets};
 
-            int d0 = die(gen);
-            int d1 = die(gen);
-            std::vector<bool> history(NUM_ACTIONS, false);
+            pruneActive = pruning && iteration % pruneRecheckEvery != 0;
+            recheckWeight = pruneRecheckEvery;
 
-            if (iter % 100 == 0) {
-                std::cout << "Iteration: " << iter << "\n";
-            }
-            
+            pPlayer[rollBase[0]] = 1;
+            pOpponent[rollBase[0]] = 1;
 
-            std::vector<bool> isClaimed(NUM_ACTIONS-1, false);
+            CFR_TELEMETRY_PHASE(Forward);
             // Accumulate realization weights forward
-            {
-                std::vector<bool> emptyClaims(NUM_ACTIONS-1, false);
-                // 0 claims in history (curr: d0, next: d1)
-                Node &initialNode = nodeMap.at(infoSetToInteger(d0, emptyClaims));
-                const std::vector<double>& actionProb = initialNode.getStrategy();
-                initialNode.pPlayer = 1;
-                initialNode.pOpponent = 1;
-
-                
-                // Iterate through next nodes
-                for (int a = initialNode.minAction; a <= initialNode.maxAction; a++) { // Here the max action is not DUDO so we include it
-                    isClaimed[a] = true;
-                    Node &nextNode = nodeMap.at(infoSetToInteger(d1, isClaimed));
-                    if (nextNode.processed == true) {
-                        std::cout << "next node processed before current node\n";
-                    }
-                    nextNode.pPlayer += initialNode.pOpponent;
-                    nextNode.pOpponent += actionProb.at(a - initialNode.minAction) * initialNode.pPlayer;
-                    isClaimed[a] = false;
-                }
-                initialNode.processed = true;
-            }
-            
-
-            // 1 claim in history (curr: d1, next: d0)
-            for (int i = 0; i < NUM_ACTIONS-1; i++) {
-                isClaimed[i] = true;
-                Node &node = nodeMap.at(infoSetToInteger(d1, isClaimed));
-                const std::vector<double>& actionProb = node.getStrategy();
-                // Iterate through next nodes
-                for (int a = node.minAction; a < node.maxAction; a++) {
-                    isClaimed[a] = true;
-                    Node &nextNode = nodeMap.at(infoSetToInteger(d0, isClaimed));
-                    if (nextNode.processed == true) {
-                        std::cout << "next node processed before current node\n";
+            for (int s = 0; s < numSets; s++) {
+                for (int p = 0; p < 2; p++) {
+                    if (!visits(p, s, rolls)) continue;
+                    int i = rollBase[p] + s;
+                    if (pPlayer[i] == 0 && pOpponent[i] == 0) continue;
+                    nodesTouched++;
+                    CFR_TELEMETRY_VISIT(__builtin_popcount(claimSets[s]), 1);
+
+                    getStrategy(i);
+                    int begin = offset[i];
+                    int n = offset[i + 1] - begin;
+                    int minAction = lastClaim[s] + 1;
+                    const double* actionProb = &strategy[begin];
+                    const int* next = &successors[successorBegin[s]];
+                    // Successors are later nodes, so the weights can be read once
+                    double reachPlayer = pPlayer[i];
+                    double reachOpponent = pOpponent[i];
+                    for (int a = 0; a < n; a++) {
+                        if (minAction + a == DUDO) continue;
+                        if (pruning) {
+                            edgesVisited++;
+                            if (isPruned(begin + a)) {
+                                edgesPruned++;
+                                continue;
+                            }
+                        }
+                        int j = rollBase[1 - p] + next[a];
+                        pPlayer[j] += reachOpponent;
+                        pOpponent[j] += actionProb[a] * reachPlayer;
                     }
-                    nextNode.pPlayer += node.pOpponent;
-                    nextNode.pOpponent += actionProb.at(a - node.minAction) * node.pPlayer;
-                    isClaimed[a] = false;
                 }
-                isClaimed[i] = false;
-                node.processed = true;
-            }
-
-            // 2 claims in history (curr: d0, next: d1)
-            for (int i = 0; i < NUM_ACTIONS-1; i++) {
-                isClaimed[i] = true;
-                for (int j = i+1; j < NUM_ACTIONS-1; j++) {
-                    isClaimed[j] = true;
-                    Node &node = nodeMap.at(infoSetToInteger(d0, isClaimed));
-                    const std::vector<double>& actionProb = node.getStrategy();
-                    // Iterate through next nodes
-                    for (int a = node.minAction; a < node.maxAction; a++) {
-                        isClaimed[a] = true;
-                        Node &nextNode = nodeMap.at(infoSetToInteger(d1, isClaimed));
-                        if (nextNode.processed == true) {
-                            std::cout << "next node processed before current node\n";
-                            std::cout << "current - d0: " << d0 << ", claims: " << i << ", " << j << "\n";
-                            std::cout << "next - d1: " << d1 << ", claims: " << i << ", " << j << ", " << a << "\n"; 
+            }
+
+            CFR_TELEMETRY_PHASE(Backward);
+            // Backpropagate utilities, adjusting regrets and strategies
+            double regret[NUM_ACTIONS];
+            for (int s = numSets - 1; s >= 0; s--) {
+                for (int p = 0; p < 2; p++) {
+                    if (!visits(p, s, rolls)) continue;
+                    int i = rollBase[p] + s;
+                    u[i] = 0.0;
+                    if (pPlayer[i] == 0 && pOpponent[i] == 0) continue;
+                    CFR_TELEMETRY_TERMINAL(claimSets[s] != 0);
+
+                    int begin = offset[i];
+                    int n = offset[i + 1] - begin;
+                    int minAction = lastClaim[s] + 1;
+                    const double* actionProb = &strategy[begin];
+                    const int* next = &successors[successorBegin[s]];
+                    double nodeUtil = 0.0;
+                    for (int a = 0; a < n; a++) {
+                        if (minAction + a == DUDO) {
+                            regret[a] = -dudoUtility(rolls, lastClaim[s]);
+                        }
+                        else {
+                            regret[a] = -u[rollBase[1 - p] + next[a]];
                         }
-                        nextNode.pPlayer += node.pOpponent;
-                        nextNode.pOpponent += actionProb.at(a - node.minAction) * node.pPlayer;
-                        isClaimed[a] = false;
+                        nodeUtil += actionProb[a] * regret[a];
+                    }
+                    // accumulate counterfactual regret for each action for the node
+                    double reachOpponent = pOpponent[i];
+                    double* nodeRegret = &regretSum[begin];
+                    for (int a = 0; a < n; a++) {
+                        double weight = (minAction + a != DUDO) ? regretWeight(begin + a) : 1.0;
+                        nodeRegret[a] += weight * reachOpponent * (regret[a] - nodeUtil);
                     }
-                    node.processed = true;
-                    isClaimed[j] = false;
+                    u[i] = nodeUtil;
+                    pPlayer[i] = pOpponent[i] = 0;
                 }
-                isClaimed[i] = false;
             }
 
-            // 3 claims in history (curr: d1, next: d0, or curr: d0, next: d1 if claim 0 hasn't been made and d0 != d1)
-            for (int i = 0; i < NUM_ACTIONS-1; i++) {
-                isClaimed[i] = true;
-                for (int j = i+1; j < NUM_ACTIONS-1; j++) {
-                    isClaimed[j] = true;
-                    for (int k = j+1; k < NUM_ACTIONS-1; k++) {
-                        isClaimed[k] = true;
+            // Reset strategy sums after half of training
+            if (!resumed && iter == iterations / 2) {
+                CFR_TELEMETRY_PHASE(Reset);
+                resetStrategySums();
+            }
+
+            gameValSum += u[rollBase[0]];
+            iteration++;
+            CFR_TELEMETRY_TICK(iter + 1, memoryUsage());
 
-                        Node &node = nodeMap.at(infoSetToInteger(d1, isClaimed));
-                        if (node.processed == true) {
-                            std::cout << "This node was already processed\n";
-                            std::cout << "current - d1: " << d1 << ", claims: " << i << ", " << j << ", " << k << "\n";
+            if (printEvery > 0 && iter % printEvery == 0) {
+                std::cout << "Iteration: " << iter << "\n";
+                std::cout << "Average game value: " << gameValSum / (iter + 1) << "\n";
+            }
+        }
+
+        CFR_TELEMETRY_FINISH(iterations, memoryUsage());
+        printResults(gameValSum / iterations);
+    }
+
+    // Train with FSICFR, sweeping batchSize sampled deals through the node graph together.
+    // Realization weights and utilities are kept per claim set and player as batchSize
+    // contiguous lanes, one per deal, indexed by (s * 2 + p) * batchSize + b. Strategies and
+    // pruning decisions are fixed at the start of each batch.
+    void trainBatched(int iterations, int batchSize) {
+        const int B = batchSize;
+        const int numSets = NUM_CLAIM_SETS;
+        int batches = (iterations + B - 1) / B;
+        double gameValSum = 0.0;
+
+        std::vector<double> laneP(numSets * 2 * B, 0.0);
+        std::vector<double> laneO(numSets * 2 * B, 0.0);
+        std::vector<double> laneU(numSets * 2 * B, 0.0);
+        // Rolls of each deal, rolls[b * 2 + p]
+        std::vector<int> rolls(2 * B);
+        // Utility of calling DUDO on claim c in deal b, dudoUtil[c * B + b]
+        std::vector<double> dudoUtil(DUDO * B);
+        // Node index of each lane at the current claim set, with the lanes' strategies and
+        // action utilities by action, laneStrategy[a * B + b]
+        std::vector<int> laneNode(B);
+        std::vector<double> laneStrategy(NUM_ACTIONS * B);
+        std::vector<double> actionUtil(NUM_ACTIONS * B);
+        // Bit a is set if the claim of action index a of the node is prunable for the whole batch
+        std::vector<uint16_t> prunedActions(NUM_NODES, 0);
+
+        // Lane b of batch i plays deal i * B + b, the same deals train samples
+        uint64_t key = cfr::makeStreamKey();
+
+        // A resumed run keeps the strategy sums it was loaded with
+        bool resumed = iteration > 0;
+
+        for (int batch = 0; batch < batches; batch++) {
+            CFR_TELEMETRY_PHASE(Sample);
+            for (int b = 0; b < B; b++) {
+                dealRolls(key, (uint64_t) batch * B + b, &rolls[b * 2]);
+            }
+            for (int c = 0; c < DUDO; c++) {
+                for (int b = 0; b < B; b++) {
+                    dudoUtil[c * B + b] = -dudoUtility(&rolls[b * 2], c);
+                }
+            }
+            CFR_TELEMETRY_TERMINAL(DUDO * B);
+
+            CFR_TELEMETRY_PHASE(Forward);
+            // Deals iteration .. iteration + B - 1 recheck if one of them is a multiple of
+            // pruneRecheckEvery, standing in for the pruneRecheckEvery deals around it
+            int recheckDeal = (iteration + B - 1) / pruneRecheckEvery * pruneRecheckEvery;
+            pruneActive = pruning && recheckDeal < iteration;
+            recheckWeight = std::max(1.0, (double) pruneRecheckEvery / B);
+            for (int i = 0; i < NUM_NODES; i++) {
+                regretMatch(i);
+                prunedActions[i] = 0;
+                int minAction = lastClaim[i % numSets] + 1;
+                for (int a = 0; a < numActions(i); a++) {
+                    if (minAction + a != DUDO && prunable(offset[i] + a)) prunedActions[i] |= 1 << a;
+                }
+            }
+
+            std::fill(laneP.begin(), laneP.begin() + B, 1.0);
+            std::fill(laneO.begin(), laneO.begin() + B, 1.0);
+
+            // Accumulate realization weights forward
+            for (int s = 0; s < numSets; s++) {
+                // With equal rolls both players' states on the set are one node, kept in player 0's lane
+                if (actors[s] == 3) {
+                    double* p = &laneP[s * 2 * B];
+                    double* o = &laneO[s * 2 * B];
+                    for (int b = 0; b < B; b++) {
+                        if (rolls[b * 2] == rolls[b * 2 + 1]) {
+                            p[b] += p[B + b];
+                            o[b] += o[B + b];
+                            p[B + b] = o[B + b] = 0;
                         }
-                        // std::cout << "current: " << i << ", " << j << ", " << k << "\n";
-                        const std::vector<double>& actionProb = node.getStrategy();
-                        // Iterate through next nodes
-                        for (int a = node.minAction; a < node.maxAction; a++) {
-                            // std::cout << "next: " << j << ", " << k << ", " << a << "\n";
-                            isClaimed[i] = false;
-                            isClaimed[a] = true;
-                            Node &nextNode = nodeMap.at(infoSetToInteger(d0, isClaimed));
-                            if (nextNode.processed == true) {
-                                std::cout << "next node processed before current node\n";
-                                std::cout << "current - d1: " << d1 << ", claims: " << i << ", " << j << ", " << k << "\n";
-                                std::cout << "next - d0: " << d0 << ", claims: " << j << ", " << k << ", " << a << "\n";    
-                            }
-                            nextNode.pPlayer += node.pOpponent;
-                            nextNode.pOpponent += actionProb.at(a - node.minAction) * node.pPlayer;
-                            isClaimed[a] = false;
-                            isClaimed[i] = true;
+                    }
+                }
+                for (int p = 0; p < 2; p++) {
+                    if (!((actors[s] >> p) & 1)) continue;
+                    const double* lanePlayer = &laneP[(s * 2 + p) * B];
+                    const double* laneOpponent = &laneO[(s * 2 + p) * B];
+                    if (std::all_of(lanePlayer, lanePlayer + B, [](double w) { return w == 0; })
+                        && std::all_of(laneOpponent, laneOpponent + B, [](double w) { return w == 0; })) {
+                        continue;
+                    }
+                    nodesTouched += B;
+                    CFR_TELEMETRY_VISIT(__builtin_popcount(claimSets[s]), B);
+
+                    // Gather each lane's strategy, summing the strategy weight by roll
+                    double rollReach[NUM_SIDES] = {};
+                    for (int b = 0; b < B; b++) {
+                        int roll = rolls[b * 2 + p] - 1;
+                        laneNode[b] = roll * numSets + s;
+                        rollReach[roll] += lanePlayer[b];
+                    }
+                    int n = numActions(s);
+                    for (int roll = 0; roll < NUM_SIDES; roll++) {
+                        int begin = offset[roll * numSets + s];
+                        for (int a = 0; a < n; a++) {
+                            strategySum[begin + a] += rollReach[roll] * strategy[begin + a];
                         }
-                        node.processed = true;
-
-                        // (curr: d0, next: d1)
-                        if (isClaimed[0] == false && d0 != d1) {
-                            Node &node = nodeMap.at(infoSetToInteger(d0, isClaimed));
-                            if (node.processed == true) {
-                                std::cout << "This node was already processed\n";
-                                std::cout << "current - d0: " << d0 << ", claims: " << i << ", " << j << ", " << k << "\n";
+                    }
+                    for (int a = 0; a < n; a++) {
+                        for (int b = 0; b < B; b++) {
+                            laneStrategy[a * B + b] = strategy[offset[laneNode[b]] + a];
+                        }
+                    }
+
+                    const int* next = &successors[successorBegin[s]];
+                    int minAction = lastClaim[s] + 1;
+                    for (int a = 0; a < n; a++) {
+                        if (minAction + a == DUDO) continue;
+                        double* nextP = &laneP[(next[a] * 2 + 1 - p) * B];
+                        double* nextO = &laneO[(next[a] * 2 + 1 - p) * B];
+                        const double* prob = &laneStrategy[a * B];
+                        if (pruning) edgesVisited += B;
+                        if (!pruneActive) {
+                            for (int b = 0; b < B; b++) {
+                                nextP[b] += laneOpponent[b];
+                                nextO[b] += prob[b] * lanePlayer[b];
                             }
-                            const std::vector<double>& actionProb = node.getStrategy();
-                            // Iterate through next nodes
-                            for (int a = node.minAction; a < node.maxAction; a++) {
-                                // std::cout << "next: " << j << ", " << k << ", " << a << "\n";
-                                isClaimed[i] = false;
-                                isClaimed[a] = true;
-                                Node &nextNode = nodeMap.at(infoSetToInteger(d1, isClaimed));
-                                if (nextNode.processed == true) {
-                                    std::cout << "\n";
-                                    std::cout << "next node processed before current node\n";
-                                    std::cout << "current - d0: " << d0 << ", claims: " << i << ", " << j << ", " << k << "\n";
-                                    std::cout << "next - d1: " << d1 << ", claims: " << j << ", " << k << ", " << a << "\n";
-                                }
-                                // else {
-
-                                //     std::cout << "\n";
-                                //     std::cout << "everything is good!\n";
-                                // }
-                                nextNode.pPlayer += node.pOpponent;
-                                nextNode.pOpponent += actionProb.at(a - node.minAction) * node.pPlayer;
-                                isClaimed[a] = false;
-                                isClaimed[i] = true;
+                            continue;
+                        }
+                        for (int b = 0; b < B; b++) {
+                            if ((prunedActions[laneNode[b]] >> a) & 1) {
+                                edgesPruned++;
+                                continue;
                             }
-                            node.processed = true;
+                            nextP[b] += laneOpponent[b];
+                            nextO[b] += prob[b] * lanePlayer[b];
                         }
-                        isClaimed[k] = false;
                     }
-                    isClaimed[j] = false;
                 }
-                isClaimed[i] = false;
             }
 
+            CFR_TELEMETRY_PHASE(Backward);
+            // Backpropagate utilities, adjusting regrets
+            for (int s = numSets - 1; s >= 0; s--) {
+                for (int p = 0; p < 2; p++) {
+                    if (!((actors[s] >> p) & 1)) continue;
+                    double* lanePlayer = &laneP[(s * 2 + p) * B];
+                    double* laneOpponent = &laneO[(s * 2 + p) * B];
+                    double* laneValue = &laneU[(s * 2 + p) * B];
+
+                    int n = numActions(s);
+                    for (int b = 0; b < B; b++) {
+                        laneNode[b] = (rolls[b * 2 + p] - 1) * numSets + s;
+                        laneValue[b] = 0.0;
+                    }
+                    for (int a = 0; a < n; a++) {
+                        for (int b = 0; b < B; b++) {
+                            laneStrategy[a * B + b] = strategy[offset[laneNode[b]] + a];
+                        }
+                    }
 
-            // Backpropagate utilities, adjusting regrets and strategies
-            // 3 claims in history (curr: d1, next: d0, or curr: d0, next: d1 if claim 0 hasn't been made and d0 != d1)
-            for (int i = NUM_ACTIONS-2; i >= 0; i--) {
-                isClaimed[i] = true;
-                for (int j = i-1; j >= 0; j--) {
-                    isClaimed[j] = true;
-                    for (int k = j-1; k >= 0; k--) {
-                        isClaimed[k] = true;
-
-                        Node &node = nodeMap.at(infoSetToInteger(d1, isClaimed));
-                        if (node.backProcessed == true) {
-                            std::cout << "This node was already backProcessed\n";
-                            std::cout << "current - d1: " << d1 << ", claims: " << i << ", " << j << ", " << k << "\n";
+                    const int* next = &successors[successorBegin[s]];
+                    int minAction = lastClaim[s] + 1;
+                    for (int a = 0; a < n; a++) {
+                        double* util = &actionUtil[a * B];
+                        const double* prob = &laneStrategy[a * B];
+                        if (minAction + a == DUDO) {
+                            std::copy(&dudoUtil[lastClaim[s] * B], &dudoUtil[lastClaim[s] * B] + B, util);
                         }
-                        // std::cout << "current: " << i << ", " << j << ", " << k << "\n";
-                        const std::vector<double>& actionProb = node.getStrategy();
-                        // Iterate through next nodes
-                        for (int a = node.minAction; a < node.maxAction; a++) {
-                            // std::cout << "next: " << j << ", " << k << ", " << a << "\n";
-                            isClaimed[i] = false;
-                            isClaimed[a] = true;
-                            Node &nextNode = nodeMap.at(infoSetToInteger(d0, isClaimed));
-                            if (nextNode.processed == true) {
-                                std::cout << "next node processed before current node\n";
-                                std::cout << "current - d1: " << d1 << ", claims: " << i << ", " << j << ", " << k << "\n";
-                                std::cout << "next - d0: " << d0 << ", claims: " << j << ", " << k << ", " << a << "\n";    
+                        else {
+                            const double* nextU = &laneU[(next[a] * 2 + 1 - p) * B];
+                            for (int b = 0; b < B; b++) {
+                                util[b] = -nextU[b];
                             }
-                            nextNode.pPlayer += node.pOpponent;
-                            nextNode.pOpponent += actionProb.at(a - node.minAction) * node.pPlayer;
-                            isClaimed[a] = false;
-                            isClaimed[i] = true;
                         }
-                        node.processed = true;
-
-                        // (curr: d0, next: d1)
-                        if (isClaimed[0] == false && d0 != d1) {
-                            Node &node = nodeMap.at(infoSetToInteger(d0, isClaimed));
-                            if (node.processed == true) {
-                                std::cout << "This node was already processed\n";
-                                std::cout << "current - d0: " << d0 << ", claims: " << i << ", " << j << ", " << k << "\n";
-                            }
-                            const std::vector<double>& actionProb = node.getStrategy();
-                            // Iterate through next nodes
-                            for (int a = node.minAction; a < node.maxAction; a++) {
-                                // std::cout << "next: " << j << ", " << k << ", " << a << "\n";
-                                isClaimed[i] = false;
-                                isClaimed[a] = true;
-                                Node &nextNode = nodeMap.at(infoSetToInteger(d1, isClaimed));
-                                if (nextNode.processed == true) {
-                                    std::cout << "\n";
-                                    std::cout << "next node processed before current node\n";
-                                    std::cout << "current - d0: " << d0 << ", claims: " << i << ", " << j << ", " << k << "\n";
-                                    std::cout << "next - d1: " << d1 << ", claims: " << j << ", " << k << ", " << a << "\n";
-                                }
-                                // else {
-
-                                //     std::cout << "\n";
-                                //     std::cout << "everything is good!\n";
-                                // }
-                                nextNode.pPlayer += node.pOpponent;
-                                nextNode.pOpponent += actionProb.at(a - node.minAction) * node.pPlayer;
-                                isClaimed[a] = false;
-                                isClaimed[i] = true;
-                            }
+                        for (int b = 0; b < B; b++) {
+                            laneValue[b] += prob[b] * util[b];
+                        }
+                    }
+                    // accumulate counterfactual regret for each action for each lane's node
+                    for (int a = 0; a < n; a++) {
+                        const double* util = &actionUtil[a * B];
+                        double prunedWeight = pruneActive ? 0.0 : recheckWeight;
+                        for (int b = 0; b < B; b++) {
+                            double weight = ((prunedActions[laneNode[b]] >> a) & 1) ? prunedWeight : 1.0;
+                            regretSum[offset[laneNode[b]] + a] += weight * laneOpponent[b] * (util[b] - laneValue[b]);
+                        }
+                    }
+                    std::fill(lanePlayer, lanePlayer + B, 0.0);
+                    std::fill(laneOpponent, laneOpponent + B, 0.0);
+                }
+                if (actors[s] == 3) {
+                    for (int b = 0; b < B; b++) {
+                        if (rolls[b * 2] == rolls[b * 2 + 1]) {
+                            laneU[(s * 2 + 1) * B + b] = laneU[s * 2 * B + b];
                         }
-
-                        node.processed = true;
-                        isClaimed[k] = false;
                     }
-                    isClaimed[j] = false;
                 }
-                isClaimed[i] = false;
             }
 
+            // Reset strategy sums after half of training
+            if (!resumed && batch == batches / 2) {
+                CFR_TELEMETRY_PHASE(Reset);
+                resetStrategySums();
+            }
 
+            for (int b = 0; b < B; b++) {
+                gameValSum += laneU[b];
+            }
+            iteration += B;
+            CFR_TELEMETRY_TICK((batch + 1) * B, memoryUsage());
 
+            if (printEvery > 0 && (batch * B) % printEvery < B) {
+                std::cout << "Iteration: " << batch * B << "\n";
+                std::cout << "Average game value: " << gameValSum / ((batch + 1.0) * B) << "\n";
+            }
+        }
 
+        CFR_TELEMETRY_FINISH((uint64_t) batches * B, memoryUsage());
+        printResults(gameValSum / ((double) batches * B));
+    }
 
+    // Write the average strategies to output.txt and print the average game value
+    void printResults(double avgGameValue) {
+        if (!printSummary) {
+            return;
+        }
+        std::ofstream out("output.txt");
+        for (int i = 0; i < NUM_NODES; i++) {
+            out << nodeToString(i) << "\n";
+        }
 
-            // Reset strategy sums after half of training
-            if (iter == iterations / 2) {
-                for (auto& [_, node] : nodeMap) {
-                    for (int a = 0; a < node.strategySum.size(); a++) {
-                        node.strategySum[a] = 0;
-                    }
-                }
-            }
+        std::cout << "Final average game value: " << avgGameValue << "\n";
+        std::cout << NUM_NODES << " information sets\n";
+        if (pruning) {
+            std::cout << "Pruned " << edgesPruned << " of " << edgesVisited << " action edges\n";
+        }
+    }
+};
 
-            std::vector<bool> emptyClaims(NUM_ACTIONS-1, false);
-            gameValSum += nodeMap.at(infoSetToInteger(d0, emptyClaims)).u;
-            std::cout << "d0: " << d0 << ", d1: " << d1 << "\n";
-            // std::cout << nodeMap.at(intialNodeKey).infoSet << "\n";
 
+// Command line settings shared by every memory depth
+struct Dudo3Options {
+    int iterations = 100000;
+    std::string loadPath;
+    std::string savePath;
+    std::string policyPath;
+    bool pruning = false;
+    double pruneThreshold = -20.0;
+    int batchSize = 1;
+    int printEvery = 0;
+    std::string telemetryPath;
+    double telemetryEvery = 1.0;
+};
 
+template<int MEMORY>
+int runDudo3(const Dudo3Options& options) {
+    Dudo3Trainer<MEMORY> trainer;
+    trainer.pruning = options.pruning;
+    trainer.pruneThreshold = options.pruneThreshold;
+    trainer.printEvery = options.printEvery;
 
+    if (!options.telemetryPath.empty()
+        && !telemetry::open(options.telemetryPath, Dudo3Trainer<MEMORY>::gameTag(), options.telemetryEvery)) {
+        return 1;
+    }
 
-        }
+    if (!options.loadPath.empty() && !trainer.loadCheckpoint(options.loadPath)) {
+        return 1;
+    }
+    if (options.batchSize > 1) {
+        trainer.trainBatched(options.iterations, options.batchSize);
+    }
+    else {
+        trainer.train(options.iterations);
+    }
+    if (!options.savePath.empty() && !trainer.saveCheckpoint(options.savePath)) {
+        return 1;
+    }
+    if (!options.policyPath.empty() && !trainer.exportPolicy(options.policyPath)) {
+        return 1;
+    }
+    return 0;
+}
 
-        
+// Micro-benchmarks of the hot paths at the default claim memory, then the training
+// throughput of each sweep from the benchmark seed
+int runBenchmarks(const bench::Options& options) {
+    using Trainer = Dudo3Trainer<3>;
+    bench::Suite suite(options);
+
+    // Mixed-sign regrets, so regret matching takes both of its branches
+    Trainer trainer;
+    std::mt19937 gen(options.seed);
+    std::uniform_real_distribution<double> regret(-1.0, 1.0);
+    for (double& r : trainer.regretSum) {
+        r = regret(gen);
+    }
+    std::fill(trainer.pPlayer.begin(), trainer.pPlayer.end(), 0.5);
+    // Sampled deals and claims for the terminal evaluation
+    const int NUM_DEALS = 4096;
+    std::vector<std::array<int, 3>> deals(NUM_DEALS);
+    std::uniform_int_distribution<int> die(1, Trainer::NUM_SIDES);
+    std::uniform_int_distribution<int> claim(0, Trainer::DUDO - 1);
+    for (auto& deal : deals) {
+        deal = {die(gen), die(gen), claim(gen)};
+    }
+    int numNodes = Trainer::NUM_NODES;
+    int numSets = trainer.claimSets.size();
+
+    suite.micro("Dudo3.getStrategy", 2000000, [&](long i) {
+        trainer.getStrategy(i % numNodes);
+        bench::doNotOptimize(trainer.strategy[trainer.offset[i % numNodes]]);
+    });
+    suite.micro("Dudo3.rankClaimSet", 2000000, [&](long i) {
+        bench::doNotOptimize(Trainer::rankClaimSet(trainer.claimSets[i % numSets]));
+    });
+    suite.micro("Dudo3.infoSetToInteger", 20000000, [&](long i) {
+        bench::doNotOptimize(trainer.infoSetToInteger(deals[i % NUM_DEALS][0], trainer.claimSets[i % numSets]));
+    });
+    suite.micro("Dudo3.claimHistoryToString", 500000, [&](long i) {
+        bench::doNotOptimize(trainer.claimHistoryToString(trainer.claimSets[i % numSets]).size());
+    });
+    suite.micro("Dudo3.dudoUtility", 20000000, [&](long i) {
+        const auto& deal = deals[i % NUM_DEALS];
+        bench::doNotOptimize(trainer.dudoUtility(deal.data(), deal[2]));
+    });
+
+    auto train = [](auto configure) {
+        return [configure](long iterations) {
+            Trainer trainer;
+            trainer.printEvery = 0;
+            trainer.printSummary = false;
+            configure(trainer, iterations);
+            return trainer.nodesTouched;
+        };
+    };
+    suite.macro("Dudo3.fsicfr", 20000, train([](Trainer& t, long n) {
+        t.train(n);
+    }));
+    suite.macro("Dudo3.fsicfr.prune", 20000, train([](Trainer& t, long n) {
+        t.pruning = true;
+        t.train(n);
+    }));
+    suite.macro("Dudo3.batched", 20000, train([](Trainer& t, long n) {
+        t.trainBatched(n, 16);
+    }));
+
+    return suite.finish();
+}
 
-        
-        int numProcessed = 0;
-        std::ofstream out("output.txt");
-        for (const auto& [_, node] : nodeMap) {
-            out << node.toString() << "\n";
-            out << "pPlayer: " << node.pPlayer << " pOpponent: " << node.pOpponent << "\n";
-            out << "minAction: " << node.minAction << ", maxAction: " << node.maxAction << "\n";
-            if (node.processed) {
-                numProcessed += 1;
-                out << "processed\n";
+// Command line summary, printed with usage errors
+static const char* USAGE =
+    "Usage: Dudo3 [iterations] [--memory K] [--load checkpoint] [--save checkpoint] [--prune] [--prune-threshold T]\n"
+    "             [--batch B] [--export-policy table] [--print-every N] [--seed S]\n"
+    "             [--telemetry file|- [--telemetry-every seconds]]   (builds with -DCFR_TELEMETRY=1)\n"
+    "       Dudo3 --bench [--baseline file] [--save-baseline file] [--tolerance percent]\n"
+    "             [--repeats R] [--bench-scale X]\n";
+
+// Report a bad command line, returning the exit status for it
+int usageError(const std::string& message) {
+    std::cerr << message << "\n" << USAGE;
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    Dudo3Options options;
+    bench::Options benchOptions;
+    int memory = 3;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (bench::parseArgument(benchOptions, argc, argv, i)) {
+                continue;
+            }
+            else if (arg == "--memory" && i + 1 < argc) {
+                memory = std::stoi(argv[++i]);
+            }
+            else if (arg == "--load" && i + 1 < argc) {
+                options.loadPath = argv[++i];
+            }
+            else if (arg == "--save" && i + 1 < argc) {
+                options.savePath = argv[++i];
+            }
+            else if (arg == "--export-policy" && i + 1 < argc) {
+                options.policyPath = argv[++i];
+            }
+            else if (arg == "--prune") {
+                options.pruning = true;
+            }
+            else if (arg == "--batch" && i + 1 < argc) {
+                options.batchSize = std::max(1, std::stoi(argv[++i]));
+            }
+            else if (arg == "--prune-threshold" && i + 1 < argc) {
+                options.pruneThreshold = std::stod(argv[++i]);
+            }
+            else if (arg == "--print-every" && i + 1 < argc) {
+                options.printEvery = std::stoi(argv[++i]);
+            }
+            else if (arg == "--seed" && i + 1 < argc) {
+                cfr::seedGenerators(std::stoull(argv[++i]));
+            }
+            else if (arg == "--telemetry" && i + 1 < argc) {
+                options.telemetryPath = argv[++i];
+            }
+            else if (arg == "--telemetry-every" && i + 1 < argc) {
+                options.telemetryEvery = std::stod(argv[++i]);
+            }
+            else if (!arg.empty() && arg.find_first_not_of("0123456789") == std::string::npos) {
+                options.iterations = std::stoi(arg);
             }
             else {
-                if (node.pOpponent != 0.0 || node.pPlayer != 0.0) {
-                    out << "something's awry here\n";
-                }
+                return usageError("Unknown argument " + arg);
             }
-            
         }
-        std::cout << numProcessed << " nodes processed in forward prop\n";
-           
     }
-};
+    catch (const std::logic_error&) {
+        // A number that std::stoi and friends couldn't read
+        return usageError("Malformed number in arguments");
+    }
 
+    if (benchOptions.enabled) {
+        return runBenchmarks(benchOptions);
+    }
 
-int main() {
-    Dudo3Trainer trainer;
-    std::cout << trainer.nodeMap.size() << " information sets \n";
-    trainer.train(1);
-    return 0;
+    switch (memory) {
+        case 1: return runDudo3<1>(options);
+        case 2: return runDudo3<2>(options);
+        case 3: return runDudo3<3>(options);
+        case 4: return runDudo3<4>(options);
+        case 5: return runDudo3<5>(options);
+        case 6: return runDudo3<6>(options);
+        case 7: return runDudo3<7>(options);
+        case 8: return runDudo3<8>(options);
+        case 9: return runDudo3<9>(options);
+        case 10: return runDudo3<10>(options);
+        case 11: return runDudo3<11>(options);
+        case 12: return runDudo3<12>(options);
+        default:
+            std::cerr << "Claim memory must be between 1 and 12\n";
+            return 1;
+    }
 }
@@ -7,14 +7,26 @@
 #include <fstream>
 #include <iomanip>
 #include <cstdlib>
+#include <cmath>
+#include <array>
+#include <memory>
+#include <type_traits>
 
+#include "Checkpoint.h"
+#include "CFR.h"
+#include "Policy.h"
+#include "Bench.h"
+
+// Liar Die node: a view of its numActions values in the trainer's node store. Claim nodes with
+// the same oppClaim share their strategy values, as only one of them is visited per sweep.
+template<class Value>
 class Node {
 public:
     // Liar Die node definitions
-    int numActions;
-    std::vector<double> regretSum;
-    std::vector<double> strategy;
-    std::vector<double> strategySum;
+    int numActions = 0;
+    Value* regretSum = nullptr;
+    Value* strategy = nullptr;
+    Value* strategySum = nullptr;
 
     // utility value for each node
     double u = 0.0;
@@ -22,108 +34,251 @@ public:
     double pPlayer = 0.0;
     double pOpponent = 0.0;
 
+    Node() = default;
+
     // Liar Die node constructor
-    Node(int numActions)
+    Node(int numActions, Value* regretSum, Value* strategy, Value* strategySum)
         : numActions(numActions),
-          regretSum(numActions, 0.0),
-          strategy(numActions, 0.0), 
-          strategySum(numActions, 0.0) {}
-    
-    // Get Liar Die node current mixed strategy through regret-matching
-    const std::vector<double>& getStrategy() {
-        double normalizingSum = 0.0;
+          regretSum(regretSum),
+          strategy(strategy),
+          strategySum(strategySum) {}
 
-        for (int i = 0; i < numActions; i++) {
-            strategy[i] = std::max(regretSum[i], 0.0);
-            normalizingSum += strategy[i];
-        }
+    // Compute Liar Die node current mixed strategy through regret-matching into out, without
+    // accumulating it into strategySum
+    const Value* regretMatch(Value* out) const {
+        cfr::regretMatch(regretSum, out, numActions);
+        return out;
+    }
 
-        for (int i = 0; i < numActions; i++) {
-            if (normalizingSum > 0) {
-                strategy[i] /= normalizingSum;
-            }
-            else {
-                strategy[i] = 1.0 / numActions;
-            }
-            strategySum[i] += pPlayer * strategy[i];
-        }
+    const Value* regretMatch() {
+        return regretMatch(strategy);
+    }
 
+    // Get Liar Die node current mixed strategy through regret-matching
+    const Value* getStrategy() {
+        cfr::regretMatchAccumulate(regretSum, strategy, strategySum, numActions, pPlayer);
         return strategy;
     }
 
     // Get Liar Die node average mixed strategy
     std::vector<double> getAverageStrategy() const {
-        std::vector<double> avg(numActions);
-        double normalizingSum = 0.0;
-
-        for (int i = 0; i < numActions; i++) {
-            normalizingSum += strategySum[i];
-        }
-        for (int i = 0; i < numActions; i++) {
-            if (normalizingSum > 0) {
-                avg[i] = strategySum[i] / normalizingSum;
-            }
-            else {
-                avg[i] = 1.0 / numActions;
-            }
-        }
-        return avg;
+        return cfr::averageStrategy(strategySum, numActions);
     }
 };
 
-class LiarDieTrainer {
+// Liar Die trainer for any number of sides. Regret and strategy sums of every node are kept
+// in a cfr::NodeStore and the strategies alongside, stored as Value: double, float to halve
+// the footprint, or a cfr::Scaled integer to halve or quarter it again.
+template<class ValueType>
+class BasicLiarDieTrainer : public cfr::NodeStore<ValueType> {
 public:
+    using Value = ValueType;
+    using Node = ::Node<Value>;
+    using Store = cfr::NodeStore<Value>;
+    using Store::offset;
+    using Store::regretSum;
+    using Store::strategySum;
+    using Store::resetStrategySums;
+    // Largest game whose strategy tables are printed after training
+    static const int MAX_PRINTED_SIDES = 50;
     // Liar Die definitions
     static const int DOUBT = 0;
     static const int ACCEPT = 1;
     int sides;
+
+    // Vanilla resets strategySum after half of training
+    using UpdateRule = cfr::UpdateRule;
+    UpdateRule updateRule = UpdateRule::Vanilla;
+    double alpha = 1.5;
+    double beta = 0.0;
+    double gamma = 2.0;
+
+    // Update-rule iterations completed so far, carried across checkpoints
+    int iteration = 0;
+
+    // Print the strategies, game value and exploitability after training
+    bool printSummary = true;
+    // Nodes updated in the backward sweeps, counted per roll sequence (per lane in
+    // trainBatched), for benchmarks
+    uint64_t nodesTouched = 0;
+
     std::vector<std::vector<Node>> responseNodes;
     std::vector<std::vector<Node>> claimNodes;
 
-    // Construct trainer and allocate player decision nodes
-    // Currently using Node(0) to initially fill the 2D array. So for any indices that are not reassigned in the for loops, they will stay as Node objects with numActions = 0.
-    // This should be fine because those indices should never be accessed during training as those are invalid game states.
-    LiarDieTrainer(int sides):sides(sides) {
-        responseNodes = std::vector<std::vector<Node>>(sides, std::vector<Node>(sides+1, Node(0)));
+    // Current strategies, laid out like the sums for the response nodes and followed by one
+    // shared set per oppClaim for the claim nodes
+    std::vector<Value> strategy;
+
+    // Construct trainer, adding the player decision nodes to the node store in checkpoint key
+    // order and then taking views of them, since adding nodes can move the sums.
+    // Invalid game states are left as empty Node views with numActions = 0. They are never
+    // accessed during training.
+    BasicLiarDieTrainer(int sides):sides(sides) {
         for (int myClaim = 0; myClaim < sides; myClaim++) {
             for (int oppClaim = myClaim + 1; oppClaim <= sides; oppClaim++) {
-                responseNodes[myClaim][oppClaim] = Node((oppClaim == 0 || oppClaim == sides) ? 1 : 2);
+                this->addNode(responseKey(myClaim, oppClaim), (oppClaim == sides) ? 1 : 2);
+            }
+        }
+        int numResponses = this->numNodes();
+        for (int oppClaim = 0; oppClaim < sides; oppClaim++) {
+            for (int roll = 1; roll <= sides; roll++) {
+                this->addNode(claimKey(oppClaim, roll), sides - oppClaim);
+            }
+        }
+        // Each oppClaim has sides claim nodes of sides - oppClaim actions
+        strategy.assign(offset[numResponses] + (size_t) sides * (sides + 1) / 2, 0);
+
+        int i = 0;
+        responseNodes = std::vector<std::vector<Node>>(sides, std::vector<Node>(sides+1));
+        for (int myClaim = 0; myClaim < sides; myClaim++) {
+            for (int oppClaim = myClaim + 1; oppClaim <= sides; oppClaim++, i++) {
+                responseNodes[myClaim][oppClaim] = Node(offset[i + 1] - offset[i], &regretSum[offset[i]],
+                                                        &strategy[offset[i]], &strategySum[offset[i]]);
             }
         }
-        claimNodes = std::vector<std::vector<Node>>(sides, std::vector<Node>(sides+1, Node(0)));
+        Value* claimStrategy = &strategy[offset[numResponses]];
+        claimNodes = std::vector<std::vector<Node>>(sides, std::vector<Node>(sides+1));
         for (int oppClaim = 0; oppClaim < sides; oppClaim++) {
+            for (int roll = 1; roll <= sides; roll++, i++) {
+                claimNodes[oppClaim][roll] = Node(sides - oppClaim, &regretSum[offset[i]], claimStrategy, &strategySum[offset[i]]);
+            }
+            claimStrategy += sides - oppClaim;
+        }
+    }
+
+    // Bytes used by the node store, the strategies and the node views
+    size_t memoryUsage() const {
+        size_t views = 2 * sides * (sides + 1) * sizeof(Node) + 2 * sides * sizeof(std::vector<Node>);
+        return this->storeBytes() + strategy.size() * sizeof(Value) + views;
+    }
+
+    void printMemoryUsage() const {
+        std::cout << this->numNodes() << " information sets, " << regretSum.size() << " action values as "
+                  << cfr::storageName<Value>() << ", "
+                  << memoryUsage() / 1024 << " KB (node store "
+                  << (this->storeBytes() + strategy.size() * sizeof(Value)) / 1024 << " KB)\n";
+    }
+
+    // Discount the accumulated sums of every node at the end of iteration t (starting at 1),
+    // and halve the fixed-point nodes nearing their range
+    void applyUpdateRule(int t) {
+        cfr::UpdateScales scales;
+        if (cfr::updateRuleScales(updateRule, alpha, beta, gamma, t, scales)) {
+            cfr::discount(scales, regretSum.data(), strategySum.data(), regretSum.size());
+        }
+        this->rescaleSums();
+    }
+
+    // Exploitability of the symmetric profile with average strategies
+    // claimStrategy(oppClaim, roll) and responseStrategy(myClaim, oppClaim): the mean of the
+    // values each player gets by best responding to it. The claimer rerolls after every
+    // accepted claim, so what a responder can infer about the die only depends on the claim
+    // in front of it, and the best response values follow by induction down from the highest
+    // claim.
+    template<class ClaimStrategy, class ResponseStrategy>
+    static double exploitability(int sides, ClaimStrategy claimStrategy, ResponseStrategy responseStrategy) {
+        // bestClaim[x]: best responder's value claiming after accepting x, averaged over its roll
+        // bestResponse[x]: best responder's value against the claims made after it accepted x
+        std::vector<double> bestClaim(sides + 1, 0.0);
+        std::vector<double> bestResponse(sides + 1, 0.0);
+        std::vector<double> doubtValue(sides + 1), claimProb(sides + 1), claimValue(sides + 1);
+
+        for (int x = sides - 1; x >= 0; x--) {
+            // Answer each claim z with the better of doubting and accepting
+            std::fill(doubtValue.begin(), doubtValue.end(), 0.0);
+            std::fill(claimProb.begin(), claimProb.end(), 0.0);
+            for (int roll = 1; roll <= sides; roll++) {
+                const auto& strategy = claimStrategy(x, roll);
+                for (int z = x + 1; z <= sides; z++) {
+                    double p = strategy[z - x - 1] / sides;
+                    claimProb[z] += p;
+                    doubtValue[z] += (z > roll) ? p : -p;
+                }
+            }
+            for (int z = x + 1; z <= sides; z++) {
+                double value = doubtValue[z];
+                if (z < sides) value = std::max(value, claimProb[z] * bestClaim[z]);
+                bestResponse[x] += value;
+            }
+
+            // Make the best claim for each roll: a doubt of claim y wins if y <= roll
+            for (int y = x + 1; y <= sides; y++) {
+                const auto& strategy = responseStrategy(x, y);
+                claimProb[y] = strategy[DOUBT];
+                claimValue[y] = (y < sides) ? strategy[ACCEPT] * bestResponse[y] : 0.0;
+            }
             for (int roll = 1; roll <= sides; roll++) {
-                claimNodes[oppClaim][roll] = Node(sides - oppClaim);
+                double best = -2.0;
+                for (int y = x + 1; y <= sides; y++) {
+                    best = std::max(best, ((y <= roll) ? claimProb[y] : -claimProb[y]) + claimValue[y]);
+                }
+                bestClaim[x] += best / sides;
             }
         }
+        return (bestClaim[0] + bestResponse[0]) / 2;
+    }
+
+    double exploitability() const {
+        return exploitability(sides,
+            [&](int oppClaim, int roll) { return claimNodes[oppClaim][roll].getAverageStrategy(); },
+            [&](int myClaim, int oppClaim) { return responseNodes[myClaim][oppClaim].getAverageStrategy(); });
+    }
+
+    // Checkpoint keys: response nodes are myClaim << 16 | oppClaim,
+    // claim nodes 1 << 32 | oppClaim << 16 | roll
+    static uint64_t responseKey(int myClaim, int oppClaim) {
+        return ((uint64_t) myClaim << 16) | oppClaim;
+    }
+
+    static uint64_t claimKey(int oppClaim, int roll) {
+        return (1ULL << 32) | ((uint64_t) oppClaim << 16) | roll;
+    }
+
+    // Save every node's regret and strategy sums and the iteration count to a binary checkpoint
+    bool saveCheckpoint(const std::string& path) const {
+        return Store::saveCheckpoint(path, "LiarDie" + std::to_string(sides), iteration);
+    }
+
+    // Write the average strategies as a policy table with the checkpoint keys
+    bool exportPolicy(const std::string& path) const {
+        return Store::exportPolicy(path, "LiarDie" + std::to_string(sides));
+    }
+
+    // Resume from a checkpoint written by saveCheckpoint for the same number of sides
+    bool loadCheckpoint(const std::string& path) {
+        return Store::loadCheckpoint(path, "LiarDie" + std::to_string(sides), iteration);
     }
 
-    // Train with FSICFR
+    // Train with FSICFR, drawing the rolls of iteration iter from Philox stream iter
     void train(int iterations) {
         double gameValSum = 0.0;
 
         std::vector<double> regret(sides);
         std::vector<int> rollAfterAcceptingClaim(sides);
 
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<int> die(1, sides);
+        uint64_t key = cfr::makeStreamKey();
+
+        // A resumed run keeps the strategy sums it was loaded with
+        bool resumed = iteration > 0;
 
         for (int iter = 0; iter < iterations; iter++) {
+            CFR_TELEMETRY_PHASE(Sample);
             // Initialize rolls and starting probabilities
+            cfr::Philox gen(key, iter);
             for (int i = 0; i < sides; i++) {
-                rollAfterAcceptingClaim[i] = die(gen);
+                rollAfterAcceptingClaim[i] = 1 + gen.below(sides);
             }
             claimNodes[0][rollAfterAcceptingClaim[0]].pPlayer = 1;
             claimNodes[0][rollAfterAcceptingClaim[0]].pOpponent = 1;
 
+            CFR_TELEMETRY_PHASE(Forward);
             // Accumulate realization weights forward
             for (int oppClaim = 0; oppClaim <= sides; oppClaim++) {
                 // Visit response nodes forward
                 if (oppClaim > 0) {
                     for (int myClaim = 0; myClaim < oppClaim; myClaim++) {
                         Node& node = responseNodes[myClaim][oppClaim];
-                        const std::vector<double>& actionProb = node.getStrategy();
+                        const Value* actionProb = node.getStrategy();
                         if (oppClaim < sides) {
                             Node& nextNode = claimNodes[oppClaim][rollAfterAcceptingClaim[oppClaim]];
                             nextNode.pPlayer += actionProb[1] * node.pPlayer;
@@ -134,25 +289,26 @@ public:
                 // Visit claim nodes forward
                 if (oppClaim < sides) {
                     Node& node = claimNodes[oppClaim][rollAfterAcceptingClaim[oppClaim]];
-                    const std::vector<double>& actionProb = node.getStrategy();
+                    const Value* actionProb = node.getStrategy();
                     for (int myClaim = oppClaim + 1; myClaim <= sides; myClaim++) {
                         double nextClaimProb = actionProb[myClaim - oppClaim - 1];
-                        if (nextClaimProb > 0) {
-                            Node& nextNode = responseNodes[oppClaim][myClaim];
-                            nextNode.pPlayer += node.pOpponent;
-                            nextNode.pOpponent += nextClaimProb * node.pPlayer;
-                        }
+                        Node& nextNode = responseNodes[oppClaim][myClaim];
+                        nextNode.pPlayer += node.pOpponent;
+                        nextNode.pOpponent += nextClaimProb * node.pPlayer;
                     }
                 }
 
             }
+            CFR_TELEMETRY_PHASE(Backward);
             // Backpropagate utilities, adjusting regrets and strategies
             for (int oppClaim = sides; oppClaim >= 0; oppClaim--) {
                 // Visit claim nodes backward
                 if (oppClaim < sides) {
                     Node& node = claimNodes[oppClaim][rollAfterAcceptingClaim[oppClaim]];
-                    std::vector<double>& actionProb = node.strategy;
+                    const Value* actionProb = node.strategy;
                     node.u = 0.0;
+                    nodesTouched++;
+                    CFR_TELEMETRY_VISIT(oppClaim, 1);
                     for (int myClaim = oppClaim + 1; myClaim <= sides; myClaim++) {
                         int actionIndex = myClaim - oppClaim - 1;
                         Node& nextNode = responseNodes[oppClaim][myClaim];
@@ -161,7 +317,7 @@ public:
                         node.u += actionProb[actionIndex] * childUtil;
                     }
                     // accumulate counterfactual regret for each action for the node
-                    for (int a = 0; a < actionProb.size(); a++) {
+                    for (int a = 0; a < node.numActions; a++) {
                         regret[a] -= node.u;
                         node.regretSum[a] += node.pOpponent * regret[a];
                     }
@@ -171,8 +327,11 @@ public:
                 if (oppClaim > 0) {
                     for (int myClaim = 0; myClaim < oppClaim; myClaim++) {
                         Node& node = responseNodes[myClaim][oppClaim];
-                        std::vector<double>& actionProb = node.strategy;
+                        const Value* actionProb = node.strategy;
                         node.u = 0.0;
+                        nodesTouched++;
+                        CFR_TELEMETRY_VISIT(oppClaim, 1);
+                        CFR_TELEMETRY_TERMINAL(1);
                         double doubtUtil = (oppClaim > rollAfterAcceptingClaim[myClaim]) ? 1 : -1;
                         regret[DOUBT] = doubtUtil;
                         node.u += actionProb[DOUBT] * doubtUtil;
@@ -181,7 +340,7 @@ public:
                             regret[ACCEPT] = nextNode.u;
                             node.u += actionProb[ACCEPT] * nextNode.u;
                         }
-                        for (int a = 0; a < actionProb.size(); a++) {
+                        for (int a = 0; a < node.numActions; a++) {
                             regret[a] -= node.u;
                             node.regretSum[a] += node.pOpponent * regret[a];
                         }
@@ -189,28 +348,386 @@ public:
                     }
                 }
             }
+            CFR_TELEMETRY_PHASE(Update);
+            applyUpdateRule(++iteration);
+            CFR_TELEMETRY_TICK(iter + 1, memoryUsage());
+
             // Reset strategy sums after half of training
-            if (iter == iterations / 2) {
-                for (auto& nodes : responseNodes) {
-                    for (auto& node : nodes) {
-                        for (int a = 0; a < node.strategySum.size(); a++) {
-                            node.strategySum[a] = 0;
+            if (updateRule == UpdateRule::Vanilla && !resumed && iter == iterations / 2) {
+                CFR_TELEMETRY_PHASE(Reset);
+                resetStrategySums();
+            }
+            
+            gameValSum += claimNodes[0][rollAfterAcceptingClaim[0]].u;
+        }
+        CFR_TELEMETRY_FINISH(iterations, memoryUsage());
+        printResults(gameValSum / iterations);
+    }
+
+    // Train with FSICFR, sweeping batchSize sampled roll sequences through the node graph
+    // together. Each lane carries its own realization weights and utilities, laid out
+    // contiguously per claim or response state, while strategies stay fixed for the whole
+    // batch. A batch is therefore one update-rule iteration.
+    void trainBatched(int iterations, int batchSize) {
+        const int B = batchSize;
+        const int numResponses = sides * (sides + 1);
+        int batches = (iterations + B - 1) / B;
+        double gameValSum = 0.0;
+
+        // rolls[c * B + b]: roll of lane b after accepting claim c
+        std::vector<int> rolls(sides * B);
+        // Lane weights and utilities of claim states, indexed by oppClaim * B + b
+        std::vector<double> claimP(sides * B, 0.0), claimO(sides * B, 0.0), claimU(sides * B, 0.0);
+        // Lane weights and utilities of response states, indexed by (myClaim * (sides + 1) + oppClaim) * B + b
+        std::vector<double> responseP(numResponses * B, 0.0), responseO(numResponses * B, 0.0), responseU(numResponses * B, 0.0);
+        // Strategy and regretSum of each lane's claim node, and claim state reach summed by roll
+        std::vector<const Value*> laneStrategy(B);
+        std::vector<Value*> laneRegretSum(B);
+        std::vector<double> rollReach(sides + 1, 0.0);
+        // Current strategy of the claim state's node for each roll, rollStrategy[roll * sides + a],
+        // as claim nodes share their strategy values. rollSeen marks the rolls the lanes use.
+        std::vector<Value> rollStrategy((sides + 1) * sides);
+        std::vector<char> rollSeen(sides + 1, 0);
+        auto matchRollStrategies = [&](int oppClaim) {
+            for (int b = 0; b < B; b++) {
+                int roll = rolls[oppClaim * B + b];
+                if (!rollSeen[roll]) {
+                    rollSeen[roll] = 1;
+                    claimNodes[oppClaim][roll].regretMatch(&rollStrategy[roll * sides]);
+                }
+                laneStrategy[b] = &rollStrategy[roll * sides];
+            }
+        };
+
+        // Lane b of batch i plays deal i * B + b, the same rolls train samples
+        uint64_t key = cfr::makeStreamKey();
+
+        // A resumed run keeps the strategy sums it was loaded with
+        bool resumed = iteration > 0;
+
+        for (int batch = 0; batch < batches; batch++) {
+            CFR_TELEMETRY_PHASE(Sample);
+            for (int b = 0; b < B; b++) {
+                cfr::Philox gen(key, (uint64_t) batch * B + b);
+                for (int i = 0; i < sides; i++) {
+                    rolls[i * B + b] = 1 + gen.below(sides);
+                }
+            }
+            for (auto& nodes : responseNodes) {
+                for (auto& node : nodes) {
+                    node.regretMatch();
+                }
+            }
+            std::fill(claimP.begin(), claimP.begin() + B, 1.0);
+            std::fill(claimO.begin(), claimO.begin() + B, 1.0);
+
+            CFR_TELEMETRY_PHASE(Forward);
+            // Accumulate realization weights forward
+            for (int oppClaim = 0; oppClaim <= sides; oppClaim++) {
+                // Visit response states forward
+                for (int myClaim = 0; myClaim < oppClaim; myClaim++) {
+                    Node& node = responseNodes[myClaim][oppClaim];
+                    const double* p = &responseP[(myClaim * (sides + 1) + oppClaim) * B];
+                    const double* o = &responseO[(myClaim * (sides + 1) + oppClaim) * B];
+                    double pSum = 0.0;
+                    for (int b = 0; b < B; b++) {
+                        pSum += p[b];
+                    }
+                    for (int a = 0; a < node.numActions; a++) {
+                        node.strategySum[a] += pSum * node.strategy[a];
+                    }
+                    if (oppClaim < sides) {
+                        double acceptProb = node.strategy[ACCEPT];
+                        double* nextP = &claimP[oppClaim * B];
+                        double* nextO = &claimO[oppClaim * B];
+                        for (int b = 0; b < B; b++) {
+                            nextP[b] += acceptProb * p[b];
+                            nextO[b] += o[b];
                         }
                     }
                 }
-                for (auto& nodes : claimNodes) {
-                    for (auto& node : nodes) {
-                        for (int a = 0; a < node.strategySum.size(); a++) {
-                            node.strategySum[a] = 0;
+                // Visit claim states forward
+                if (oppClaim < sides) {
+                    const double* p = &claimP[oppClaim * B];
+                    const double* o = &claimO[oppClaim * B];
+                    matchRollStrategies(oppClaim);
+                    for (int b = 0; b < B; b++) {
+                        rollReach[rolls[oppClaim * B + b]] += p[b];
+                    }
+                    for (int roll = 1; roll <= sides; roll++) {
+                        if (!rollSeen[roll]) continue;
+                        Node& node = claimNodes[oppClaim][roll];
+                        for (int a = 0; a < node.numActions; a++) {
+                            node.strategySum[a] += rollReach[roll] * rollStrategy[roll * sides + a];
+                        }
+                        rollReach[roll] = 0;
+                        rollSeen[roll] = 0;
+                    }
+                    for (int myClaim = oppClaim + 1; myClaim <= sides; myClaim++) {
+                        int actionIndex = myClaim - oppClaim - 1;
+                        double* nextP = &responseP[(oppClaim * (sides + 1) + myClaim) * B];
+                        double* nextO = &responseO[(oppClaim * (sides + 1) + myClaim) * B];
+                        for (int b = 0; b < B; b++) {
+                            nextP[b] += o[b];
+                            nextO[b] += laneStrategy[b][actionIndex] * p[b];
                         }
                     }
                 }
             }
-            
-            gameValSum += claimNodes[0][rollAfterAcceptingClaim[0]].u;
+
+            CFR_TELEMETRY_PHASE(Backward);
+            // Backpropagate utilities, adjusting regrets
+            for (int oppClaim = sides; oppClaim >= 0; oppClaim--) {
+                // Visit claim states backward
+                if (oppClaim < sides) {
+                    double* u = &claimU[oppClaim * B];
+                    double* o = &claimO[oppClaim * B];
+                    // Regrets are unchanged since the forward visit, so this matches the same strategies
+                    matchRollStrategies(oppClaim);
+                    for (int b = 0; b < B; b++) {
+                        laneRegretSum[b] = claimNodes[oppClaim][rolls[oppClaim * B + b]].regretSum;
+                        u[b] = 0.0;
+                    }
+                    std::fill(rollSeen.begin(), rollSeen.end(), 0);
+                    nodesTouched += B;
+                    CFR_TELEMETRY_VISIT(oppClaim, B);
+                    for (int myClaim = oppClaim + 1; myClaim <= sides; myClaim++) {
+                        int actionIndex = myClaim - oppClaim - 1;
+                        const double* childU = &responseU[(oppClaim * (sides + 1) + myClaim) * B];
+                        for (int b = 0; b < B; b++) {
+                            u[b] -= laneStrategy[b][actionIndex] * childU[b];
+                        }
+                    }
+                    // accumulate counterfactual regret for each action for each lane's node
+                    for (int myClaim = oppClaim + 1; myClaim <= sides; myClaim++) {
+                        int actionIndex = myClaim - oppClaim - 1;
+                        const double* childU = &responseU[(oppClaim * (sides + 1) + myClaim) * B];
+                        for (int b = 0; b < B; b++) {
+                            laneRegretSum[b][actionIndex] += o[b] * (-childU[b] - u[b]);
+                        }
+                    }
+                    std::fill(o, o + B, 0.0);
+                    std::fill(&claimP[oppClaim * B], &claimP[oppClaim * B] + B, 0.0);
+                }
+                // Visit response states backward, summing the lanes' regrets
+                for (int myClaim = 0; myClaim < oppClaim; myClaim++) {
+                    Node& node = responseNodes[myClaim][oppClaim];
+                    int r = (myClaim * (sides + 1) + oppClaim) * B;
+                    double doubtProb = node.strategy[DOUBT];
+                    double acceptProb = (oppClaim < sides) ? double(node.strategy[ACCEPT]) : 0.0;
+                    const double* acceptUtil = &claimU[std::min(oppClaim, sides - 1) * B];
+                    double doubtRegret = 0.0;
+                    double acceptRegret = 0.0;
+                    nodesTouched += B;
+                    CFR_TELEMETRY_VISIT(oppClaim, B);
+                    CFR_TELEMETRY_TERMINAL(B);
+                    for (int b = 0; b < B; b++) {
+                        double doubtUtil = (oppClaim > rolls[myClaim * B + b]) ? 1 : -1;
+                        double u = doubtProb * doubtUtil + acceptProb * acceptUtil[b];
+                        doubtRegret += responseO[r + b] * (doubtUtil - u);
+                        acceptRegret += responseO[r + b] * (acceptUtil[b] - u);
+                        responseU[r + b] = u;
+                        responseP[r + b] = responseO[r + b] = 0;
+                    }
+                    node.regretSum[DOUBT] += doubtRegret;
+                    if (oppClaim < sides) {
+                        node.regretSum[ACCEPT] += acceptRegret;
+                    }
+                }
+            }
+            CFR_TELEMETRY_PHASE(Update);
+            applyUpdateRule(++iteration);
+            CFR_TELEMETRY_TICK((batch + 1) * B, memoryUsage());
+
+            // Reset strategy sums after half of training
+            if (updateRule == UpdateRule::Vanilla && !resumed && batch == batches / 2) {
+                CFR_TELEMETRY_PHASE(Reset);
+                resetStrategySums();
+            }
+
+            for (int b = 0; b < B; b++) {
+                gameValSum += claimU[b];
+            }
+        }
+        CFR_TELEMETRY_FINISH((uint64_t) batches * B, memoryUsage());
+        printResults(gameValSum / ((double) batches * B));
+    }
+
+    // Train with expected-value FSICFR. Instead of sampling rolls, every roll at each claim
+    // state is weighted by its probability 1 / sides, so iterations are deterministic. Claim
+    // state reach doesn't depend on the roll made there and is one value per state, while
+    // response state weights and utilities depend on the claimer's roll and are kept as lanes
+    // over the roll, indexed roll-major so the per-roll loops vectorize.
+    void trainExact(int iterations) {
+        const int R = sides;
+        const double chance = 1.0 / sides;
+        const int numResponses = sides * (sides + 1);
+        double gameValSum = 0.0;
+
+        std::vector<double> claimP(sides, 0.0), claimO(sides, 0.0);
+        // Claim node utilities, claimU[oppClaim * R + roll - 1]
+        std::vector<double> claimU(sides * R, 0.0);
+        std::vector<double> responseP(numResponses, 0.0);
+        // Response lanes, indexed by (myClaim * (sides + 1) + oppClaim) * R + roll - 1 for the claimer's roll
+        std::vector<double> responseO(numResponses * R, 0.0), responseU(numResponses * R, 0.0);
+        // Strategies of the current claim state's nodes, rollStrategy[a * R + roll - 1]
+        std::vector<double> rollStrategy(sides * R);
+        std::vector<Value> strategy(sides);
+        std::vector<double> u(R);
+
+        auto matchRollStrategies = [&](int oppClaim) {
+            for (int roll = 1; roll <= sides; roll++) {
+                const Node& node = claimNodes[oppClaim][roll];
+                node.regretMatch(strategy.data());
+                for (int a = 0; a < node.numActions; a++) {
+                    rollStrategy[a * R + roll - 1] = strategy[a];
+                }
+            }
+        };
+
+        // A resumed run keeps the strategy sums it was loaded with
+        bool resumed = iteration > 0;
+
+        for (int iter = 0; iter < iterations; iter++) {
+            claimP[0] = 1;
+            claimO[0] = 1;
+
+            CFR_TELEMETRY_PHASE(Forward);
+            // Accumulate realization weights forward
+            for (int oppClaim = 0; oppClaim <= sides; oppClaim++) {
+                // Visit response states forward
+                for (int myClaim = 0; myClaim < oppClaim; myClaim++) {
+                    Node& node = responseNodes[myClaim][oppClaim];
+                    int r = myClaim * (sides + 1) + oppClaim;
+                    node.pPlayer = responseP[r];
+                    const Value* actionProb = node.getStrategy();
+                    if (oppClaim < sides) {
+                        const double* o = &responseO[r * R];
+                        double oSum = 0.0;
+                        for (int roll = 0; roll < R; roll++) {
+                            oSum += o[roll];
+                        }
+                        claimP[oppClaim] += actionProb[ACCEPT] * responseP[r];
+                        claimO[oppClaim] += chance * oSum;
+                    }
+                }
+                // Visit claim states forward
+                if (oppClaim < sides) {
+                    matchRollStrategies(oppClaim);
+                    for (int roll = 1; roll <= sides; roll++) {
+                        Node& node = claimNodes[oppClaim][roll];
+                        for (int a = 0; a < node.numActions; a++) {
+                            node.strategySum[a] += chance * claimP[oppClaim] * rollStrategy[a * R + roll - 1];
+                        }
+                    }
+                    for (int myClaim = oppClaim + 1; myClaim <= sides; myClaim++) {
+                        int r = oppClaim * (sides + 1) + myClaim;
+                        const double* prob = &rollStrategy[(myClaim - oppClaim - 1) * R];
+                        double* o = &responseO[r * R];
+                        responseP[r] += claimO[oppClaim];
+                        for (int roll = 0; roll < R; roll++) {
+                            o[roll] += prob[roll] * claimP[oppClaim];
+                        }
+                    }
+                }
+            }
+
+            CFR_TELEMETRY_PHASE(Backward);
+            // Backpropagate utilities, adjusting regrets
+            for (int oppClaim = sides; oppClaim >= 0; oppClaim--) {
+                // Visit claim states backward
+                if (oppClaim < sides) {
+                    // Regrets are unchanged since the forward visit, so this matches the same strategies
+                    matchRollStrategies(oppClaim);
+                    std::fill(u.begin(), u.end(), 0.0);
+                    nodesTouched += sides;
+                    CFR_TELEMETRY_VISIT(oppClaim, sides);
+                    for (int myClaim = oppClaim + 1; myClaim <= sides; myClaim++) {
+                        const double* prob = &rollStrategy[(myClaim - oppClaim - 1) * R];
+                        const double* childU = &responseU[(oppClaim * (sides + 1) + myClaim) * R];
+                        for (int roll = 0; roll < R; roll++) {
+                            u[roll] -= prob[roll] * childU[roll];
+                        }
+                    }
+                    // accumulate counterfactual regret for each action for each roll's node
+                    double weight = chance * claimO[oppClaim];
+                    for (int myClaim = oppClaim + 1; myClaim <= sides; myClaim++) {
+                        int actionIndex = myClaim - oppClaim - 1;
+                        const double* childU = &responseU[(oppClaim * (sides + 1) + myClaim) * R];
+                        for (int roll = 1; roll <= sides; roll++) {
+                            claimNodes[oppClaim][roll].regretSum[actionIndex] += weight * (-childU[roll - 1] - u[roll - 1]);
+                        }
+                    }
+                    std::copy(u.begin(), u.end(), &claimU[oppClaim * R]);
+                    claimP[oppClaim] = claimO[oppClaim] = 0;
+                }
+                // Visit response states backward, in expectation over the next roll
+                double acceptUtil = 0.0;
+                if (oppClaim < sides) {
+                    for (int roll = 0; roll < R; roll++) {
+                        acceptUtil += chance * claimU[oppClaim * R + roll];
+                    }
+                }
+                for (int myClaim = 0; myClaim < oppClaim; myClaim++) {
+                    Node& node = responseNodes[myClaim][oppClaim];
+                    int r = myClaim * (sides + 1) + oppClaim;
+                    double doubtProb = node.strategy[DOUBT];
+                    double acceptProb = (oppClaim < sides) ? double(node.strategy[ACCEPT]) : 0.0;
+                    double* o = &responseO[r * R];
+                    double* responseUtil = &responseU[r * R];
+                    double doubtRegret = 0.0;
+                    double acceptRegret = 0.0;
+                    nodesTouched++;
+                    CFR_TELEMETRY_VISIT(oppClaim, 1);
+                    CFR_TELEMETRY_TERMINAL(R);
+                    for (int roll = 0; roll < R; roll++) {
+                        double doubtUtil = (oppClaim > roll + 1) ? 1 : -1;
+                        double nodeUtil = doubtProb * doubtUtil + acceptProb * acceptUtil;
+                        doubtRegret += o[roll] * (doubtUtil - nodeUtil);
+                        acceptRegret += o[roll] * (acceptUtil - nodeUtil);
+                        responseUtil[roll] = nodeUtil;
+                        o[roll] = 0;
+                    }
+                    node.regretSum[DOUBT] += chance * doubtRegret;
+                    if (oppClaim < sides) {
+                        node.regretSum[ACCEPT] += chance * acceptRegret;
+                    }
+                    responseP[r] = 0;
+                }
+            }
+            CFR_TELEMETRY_PHASE(Update);
+            applyUpdateRule(++iteration);
+            CFR_TELEMETRY_TICK(iter + 1, memoryUsage());
+
+            // Reset strategy sums after half of training
+            if (updateRule == UpdateRule::Vanilla && !resumed && iter == iterations / 2) {
+                CFR_TELEMETRY_PHASE(Reset);
+                resetStrategySums();
+            }
+
+            double gameValue = 0.0;
+            for (int roll = 0; roll < R; roll++) {
+                gameValue += chance * claimU[roll];
+            }
+            gameValSum += gameValue;
+        }
+        CFR_TELEMETRY_FINISH(iterations, memoryUsage());
+        printResults(gameValSum / iterations);
+    }
+
+    // Print resulting strategy and the average game value
+    void printResults(double avgGameValue) {
+        if (!printSummary) {
+            return;
         }
-        // Print resulting strategy
         std::cout << std::fixed << std::setprecision(5);
+        // Past MAX_PRINTED_SIDES the tables run to millions of lines; save a checkpoint instead
+        if (sides > MAX_PRINTED_SIDES) {
+            printMemoryUsage();
+            std::cout << "Average game value: " << avgGameValue << "\n";
+            std::cout << "Exploitability: " << exploitability() << "\n";
+            return;
+        }
         for (int initialRoll = 1; initialRoll <= sides; initialRoll++) {
             std:: cout << "Initial claim policy with roll " << initialRoll << "\n";
             for (double& prob : claimNodes[0][initialRoll].getAverageStrategy()) {
@@ -248,22 +765,773 @@ public:
             }
         }
 
-        double avgGameValue = gameValSum / iterations;
+        printMemoryUsage();
         std::cout << "Average game value: " << avgGameValue << "\n";
+        std::cout << "Exploitability: " << exploitability() << "\n";
     }
 };
 
-int main(int argc, char* argv[]) {
+using LiarDieTrainer = BasicLiarDieTrainer<double>;
+
+// Liar Die trainer specialized at compile time for SIDES. Response states (myClaim < oppClaim)
+// are packed triangularly and every per-action value lives in one fixed-size array, so the
+// sweeps index straight into contiguous storage instead of going through per-node vectors.
+// Checkpoints use the same keys and layout as LiarDieTrainer.
+template<int SIDES>
+class FixedLiarDieTrainer {
+public:
+    static const int DOUBT = LiarDieTrainer::DOUBT;
+    static const int ACCEPT = LiarDieTrainer::ACCEPT;
+    // Response states, each with DOUBT and ACCEPT values (ACCEPT unused when oppClaim == SIDES)
+    static constexpr int NUM_RESPONSES = SIDES * (SIDES + 1) / 2;
+    // Claim states with oppClaim and roll have SIDES - oppClaim actions
+    static constexpr int NUM_CLAIM_STATES = SIDES * SIDES;
+    static constexpr int NUM_CLAIM_VALUES = SIDES * NUM_RESPONSES;
+
+    using Value = double;
+    using UpdateRule = cfr::UpdateRule;
+    UpdateRule updateRule = UpdateRule::Vanilla;
+    double alpha = 1.5;
+    double beta = 0.0;
+    double gamma = 2.0;
+
+    // Update-rule iterations completed so far, carried across checkpoints
+    int iteration = 0;
+
+    // Print the strategies, game value and exploitability after training
+    bool printSummary = true;
+    // States updated in the backward sweeps, for benchmarks
+    uint64_t nodesTouched = 0;
+
+    std::array<double, 2 * NUM_RESPONSES> responseRegretSum{};
+    std::array<double, 2 * NUM_RESPONSES> responseStrategy{};
+    std::array<double, 2 * NUM_RESPONSES> responseStrategySum{};
+    std::array<double, NUM_RESPONSES> responseU{};
+    std::array<double, NUM_RESPONSES> responseP{};
+    std::array<double, NUM_RESPONSES> responseO{};
+
+    std::array<double, NUM_CLAIM_VALUES> claimRegretSum{};
+    std::array<double, NUM_CLAIM_VALUES> claimStrategy{};
+    std::array<double, NUM_CLAIM_VALUES> claimStrategySum{};
+    std::array<double, NUM_CLAIM_STATES> claimU{};
+    std::array<double, NUM_CLAIM_STATES> claimP{};
+    std::array<double, NUM_CLAIM_STATES> claimO{};
+
+    // Response state of myClaim < oppClaim
+    static constexpr int responseIndex(int myClaim, int oppClaim) {
+        return oppClaim * (oppClaim - 1) / 2 + myClaim;
+    }
+
+    static constexpr int responseActions(int oppClaim) {
+        return (oppClaim == SIDES) ? 1 : 2;
+    }
+
+    static constexpr int claimIndex(int oppClaim, int roll) {
+        return oppClaim * SIDES + roll - 1;
+    }
+
+    // First value of claim state oppClaim, roll; action a claims oppClaim + 1 + a
+    static constexpr int claimOffset(int oppClaim, int roll) {
+        return SIDES * (oppClaim * SIDES - oppClaim * (oppClaim - 1) / 2) + (roll - 1) * (SIDES - oppClaim);
+    }
+
+    // Regret-match n actions into strategy, adding weight times the strategy to strategySum
+    static void regretMatch(const double* regretSum, double* strategy, double* strategySum, int n, double weight) {
+        cfr::regretMatchAccumulate(regretSum, strategy, strategySum, n, weight);
+    }
+
+    // Discount the accumulated sums at the end of iteration t (starting at 1)
+    void applyUpdateRule(int t) {
+        cfr::UpdateScales scales;
+        if (!cfr::updateRuleScales(updateRule, alpha, beta, gamma, t, scales)) {
+            return;
+        }
+        cfr::discount(scales, responseRegretSum.data(), responseStrategySum.data(), responseRegretSum.size());
+        cfr::discount(scales, claimRegretSum.data(), claimStrategySum.data(), claimRegretSum.size());
+    }
+
+    // Every valid state as checkpoint key, offset of its first value and number of values,
+    // in BasicLiarDieTrainer's node store order
+    struct KeyedState {
+        uint64_t key;
+        bool response;
+        int offset;
+        int numActions;
+    };
+
+    std::vector<KeyedState> keyedStates() const {
+        std::vector<KeyedState> states;
+        for (int myClaim = 0; myClaim < SIDES; myClaim++) {
+            for (int oppClaim = myClaim + 1; oppClaim <= SIDES; oppClaim++) {
+                states.push_back({LiarDieTrainer::responseKey(myClaim, oppClaim), true,
+                                  2 * responseIndex(myClaim, oppClaim), responseActions(oppClaim)});
+            }
+        }
+        for (int oppClaim = 0; oppClaim < SIDES; oppClaim++) {
+            for (int roll = 1; roll <= SIDES; roll++) {
+                states.push_back({LiarDieTrainer::claimKey(oppClaim, roll), false,
+                                  claimOffset(oppClaim, roll), SIDES - oppClaim});
+            }
+        }
+        return states;
+    }
+
+    // Save the regret and strategy sums in the same checkpoint format as LiarDieTrainer
+    bool saveCheckpoint(const std::string& path) const {
+        std::vector<uint64_t> keys;
+        std::vector<uint64_t> offsets{0};
+        std::vector<double> regrets;
+        std::vector<double> strategies;
+        for (const KeyedState& state : keyedStates()) {
+            const double* regret = (state.response ? responseRegretSum.data() : claimRegretSum.data()) + state.offset;
+            const double* strategy = (state.response ? responseStrategySum.data() : claimStrategySum.data()) + state.offset;
+            keys.push_back(state.key);
+            regrets.insert(regrets.end(), regret, regret + state.numActions);
+            strategies.insert(strategies.end(), strategy, strategy + state.numActions);
+            offsets.push_back(regrets.size());
+        }
+        std::string game = "LiarDie" + std::to_string(SIDES);
+        return ::saveCheckpoint(path, game, iteration, keys, offsets, regrets.data(), strategies.data());
+    }
+
+    // Write the average strategies as a policy table in the same format as LiarDieTrainer
+    bool exportPolicy(const std::string& path) const {
+        std::vector<uint64_t> keys;
+        std::vector<uint64_t> offsets{0};
+        std::vector<double> strategies;
+        for (const KeyedState& state : keyedStates()) {
+            const double* strategy = (state.response ? responseStrategySum.data() : claimStrategySum.data()) + state.offset;
+            keys.push_back(state.key);
+            strategies.insert(strategies.end(), strategy, strategy + state.numActions);
+            offsets.push_back(strategies.size());
+        }
+        return ::savePolicy(path, "LiarDie" + std::to_string(SIDES), keys, offsets, strategies.data());
+    }
+
+    // Resume from a checkpoint written by either Liar Die trainer for the same number of sides
+    bool loadCheckpoint(const std::string& path) {
+        MappedCheckpoint checkpoint;
+        if (!checkpoint.open(path, "LiarDie" + std::to_string(SIDES))) {
+            return false;
+        }
+        auto states = keyedStates();
+        const uint64_t* offsets = checkpoint.offsets();
+        if (checkpoint.header().numNodes != states.size()) {
+            std::cerr << "Checkpoint " << path << " does not match the Liar Die nodes\n";
+            return false;
+        }
+        for (size_t i = 0; i < states.size(); i++) {
+            const KeyedState& state = states[i];
+            if (checkpoint.keys()[i] != state.key || offsets[i + 1] - offsets[i] != (uint64_t) state.numActions) {
+                std::cerr << "Checkpoint " << path << " does not match the Liar Die nodes\n";
+                return false;
+            }
+            double* regret = (state.response ? responseRegretSum.data() : claimRegretSum.data()) + state.offset;
+            double* strategy = (state.response ? responseStrategySum.data() : claimStrategySum.data()) + state.offset;
+            std::copy(checkpoint.regretSum() + offsets[i], checkpoint.regretSum() + offsets[i + 1], regret);
+            std::copy(checkpoint.strategySum() + offsets[i], checkpoint.strategySum() + offsets[i + 1], strategy);
+        }
+        iteration = checkpoint.header().iteration;
+        return true;
+    }
+
+    // Train with FSICFR, drawing the rolls of iteration iter from Philox stream iter
+    void train(int iterations) {
+        double gameValSum = 0.0;
+
+        double regret[SIDES];
+        int rollAfterAcceptingClaim[SIDES];
+
+        uint64_t key = cfr::makeStreamKey();
+
+        // A resumed run keeps the strategy sums it was loaded with
+        bool resumed = iteration > 0;
+
+        for (int iter = 0; iter < iterations; iter++) {
+            CFR_TELEMETRY_PHASE(Sample);
+            // Initialize rolls and starting probabilities
+            cfr::Philox gen(key, iter);
+            for (int i = 0; i < SIDES; i++) {
+                rollAfterAcceptingClaim[i] = 1 + gen.below(SIDES);
+            }
+            int root = claimIndex(0, rollAfterAcceptingClaim[0]);
+            claimP[root] = 1;
+            claimO[root] = 1;
+
+            CFR_TELEMETRY_PHASE(Forward);
+            // Accumulate realization weights forward
+            for (int oppClaim = 0; oppClaim <= SIDES; oppClaim++) {
+                // Visit response states forward
+                for (int myClaim = 0; myClaim < oppClaim; myClaim++) {
+                    int r = responseIndex(myClaim, oppClaim);
+                    double* actionProb = &responseStrategy[2 * r];
+                    regretMatch(&responseRegretSum[2 * r], actionProb, &responseStrategySum[2 * r],
+                                responseActions(oppClaim), responseP[r]);
+                    if (oppClaim < SIDES) {
+                        int next = claimIndex(oppClaim, rollAfterAcceptingClaim[oppClaim]);
+                        claimP[next] += actionProb[ACCEPT] * responseP[r];
+                        claimO[next] += responseO[r];
+                    }
+                }
+                // Visit claim states forward
+                if (oppClaim < SIDES) {
+                    int c = claimIndex(oppClaim, rollAfterAcceptingClaim[oppClaim]);
+                    int offset = claimOffset(oppClaim, rollAfterAcceptingClaim[oppClaim]);
+                    double* actionProb = &claimStrategy[offset];
+                    regretMatch(&claimRegretSum[offset], actionProb, &claimStrategySum[offset], SIDES - oppClaim, claimP[c]);
+                    for (int myClaim = oppClaim + 1; myClaim <= SIDES; myClaim++) {
+                        int next = responseIndex(oppClaim, myClaim);
+                        responseP[next] += claimO[c];
+                        responseO[next] += actionProb[myClaim - oppClaim - 1] * claimP[c];
+                    }
+                }
+            }
+
+            CFR_TELEMETRY_PHASE(Backward);
+            // Backpropagate utilities, adjusting regrets and strategies
+            for (int oppClaim = SIDES; oppClaim >= 0; oppClaim--) {
+                // Visit claim states backward
+                if (oppClaim < SIDES) {
+                    int c = claimIndex(oppClaim, rollAfterAcceptingClaim[oppClaim]);
+                    int offset = claimOffset(oppClaim, rollAfterAcceptingClaim[oppClaim]);
+                    const double* actionProb = &claimStrategy[offset];
+                    double u = 0.0;
+                    nodesTouched++;
+                    CFR_TELEMETRY_VISIT(oppClaim, 1);
+                    for (int myClaim = oppClaim + 1; myClaim <= SIDES; myClaim++) {
+                        int actionIndex = myClaim - oppClaim - 1;
+                        regret[actionIndex] = -responseU[responseIndex(oppClaim, myClaim)];
+                        u += actionProb[actionIndex] * regret[actionIndex];
+                    }
+                    // accumulate counterfactual regret for each action for the state
+                    for (int a = 0; a < SIDES - oppClaim; a++) {
+                        claimRegretSum[offset + a] += claimO[c] * (regret[a] - u);
+                    }
+                    claimU[c] = u;
+                    claimP[c] = claimO[c] = 0;
+                }
+                // Visit response states backward
+                for (int myClaim = 0; myClaim < oppClaim; myClaim++) {
+                    int r = responseIndex(myClaim, oppClaim);
+                    const double* actionProb = &responseStrategy[2 * r];
+                    double doubtUtil = (oppClaim > rollAfterAcceptingClaim[myClaim]) ? 1 : -1;
+                    double u = actionProb[DOUBT] * doubtUtil;
+                    nodesTouched++;
+                    CFR_TELEMETRY_VISIT(oppClaim, 1);
+                    CFR_TELEMETRY_TERMINAL(1);
+                    double acceptUtil = 0.0;
+                    if (oppClaim < SIDES) {
+                        acceptUtil = claimU[claimIndex(oppClaim, rollAfterAcceptingClaim[oppClaim])];
+                        u += actionProb[ACCEPT] * acceptUtil;
+                        responseRegretSum[2 * r + ACCEPT] += responseO[r] * (acceptUtil - u);
+                    }
+                    responseRegretSum[2 * r + DOUBT] += responseO[r] * (doubtUtil - u);
+                    responseU[r] = u;
+                    responseP[r] = responseO[r] = 0;
+                }
+            }
+            CFR_TELEMETRY_PHASE(Update);
+            applyUpdateRule(++iteration);
+            CFR_TELEMETRY_TICK(iter + 1, sizeof(*this));
+
+            // Reset strategy sums after half of training
+            if (updateRule == UpdateRule::Vanilla && !resumed && iter == iterations / 2) {
+                CFR_TELEMETRY_PHASE(Reset);
+                responseStrategySum.fill(0.0);
+                claimStrategySum.fill(0.0);
+            }
+
+            gameValSum += claimU[root];
+        }
+        CFR_TELEMETRY_FINISH(iterations, sizeof(*this));
+        printResults(gameValSum / iterations);
+    }
+
+    double exploitability() const {
+        return LiarDieTrainer::exploitability(SIDES,
+            [&](int oppClaim, int roll) {
+                return cfr::averageStrategy(&claimStrategySum[claimOffset(oppClaim, roll)], SIDES - oppClaim);
+            },
+            [&](int myClaim, int oppClaim) {
+                return cfr::averageStrategy(&responseStrategySum[2 * responseIndex(myClaim, oppClaim)],
+                                            responseActions(oppClaim));
+            });
+    }
+
+    // Print resulting strategy and the average game value
+    void printResults(double avgGameValue) const {
+        if (!printSummary) {
+            return;
+        }
+        std::cout << std::fixed << std::setprecision(5);
+        for (int initialRoll = 1; initialRoll <= SIDES; initialRoll++) {
+            std:: cout << "Initial claim policy with roll " << initialRoll << "\n";
+            for (double& prob : cfr::averageStrategy(&claimStrategySum[claimOffset(0, initialRoll)], SIDES)) {
+                std::cout << prob << " ";
+            }
+            std::cout << "\n";
+        }
+        std::cout << "\nOld Claim\tNew Claim\tAction Probabilities\n";
+        // Response states
+        for (int myClaim = 0; myClaim < SIDES; ++myClaim) {
+            for (int oppClaim = myClaim + 1; oppClaim <= SIDES; ++oppClaim) {
+                std::cout << myClaim << "\t\t" << oppClaim << "\t\t";
+                const auto& strat = cfr::averageStrategy(&responseStrategySum[2 * responseIndex(myClaim, oppClaim)],
+                                                         responseActions(oppClaim));
+                std::cout << '[';
+                for (size_t i = 0; i < strat.size(); ++i) {
+                    if (i > 0) std::cout << ", ";
+                    std::cout << strat[i];
+                }
+                std::cout << "]\n";
+            }
+        }
+
+        std::cout << "\nOld Claim\tRoll\tAction Probabilities\n";
+        // Claim states
+        for (int oppClaim = 0; oppClaim < SIDES; ++oppClaim) {
+            for (int roll = 1; roll <= SIDES; ++roll) {
+                std::cout << oppClaim << "\t\t" << roll << '\t';
+                const auto& strat = cfr::averageStrategy(&claimStrategySum[claimOffset(oppClaim, roll)], SIDES - oppClaim);
+                std::cout << '[';
+                for (size_t i = 0; i < strat.size(); ++i) {
+                    if (i > 0) std::cout << ", ";
+                    std::cout << strat[i];
+                }
+                std::cout << "]\n";
+            }
+        }
+
+        std::cout << "Average game value: " << avgGameValue << "\n";
+        std::cout << "Exploitability: " << exploitability() << "\n";
+    }
+};
+
+// Command line settings shared by both trainers
+struct LiarDieOptions {
     int iterations = 1000;
     int sides = 6;
+    std::string rule = "vanilla";
+    double alpha = 1.5, beta = 0.0, gamma = 2.0;
+    std::string loadPath;
+    std::string savePath;
+    std::string policyPath;
+    int batchSize = 1;
+    // Expected-value sweeps over every roll instead of sampling
+    bool exact = false;
+    // Use the runtime-sides trainer even when a specialized one exists
+    bool generic = false;
+    // Value type of the runtime-sides trainer's sums: float64, float32, int32 or int16
+    std::string storage = "float64";
+    // External-sampling MCCFR on LiarDieGame instead of FSICFR
+    bool monteCarlo = false;
+    std::string telemetryPath;
+    double telemetryEvery = 1.0;
+};
+
+// Liar Die as a cfr::Game for the generic drivers. Unlike the FSICFR trainers, which draw
+// every reroll up front, chance is a node in the middle of the game: accepting a claim hands
+// the die to the responder, who rerolls before claiming higher. Information sets use the
+// checkpoint keys of LiarDieTrainer.
+class LiarDieGame {
+public:
+    static const int DOUBT = LiarDieTrainer::DOUBT;
+    static const int ACCEPT = LiarDieTrainer::ACCEPT;
+    int sides;
+
+    explicit LiarDieGame(int sides = 6) : sides(sides) {}
+
+    struct State {
+        int accepted = 0;   // claim last accepted, 0 before the first claim
+        int claim = 0;      // claim awaiting a response, 0 while the die holder claims
+        int roll = 0;       // die under the cup, 0 until rolled
+        int player = 0;     // player to act
+        int winner = -1;    // set when a claim is doubted
+    };
+
+    State root() const {
+        return State{};
+    }
+
+    bool isTerminal(const State& state) const {
+        return state.winner >= 0;
+    }
 
-    // Take a command line argument for number of iterations
-    if (argc > 2) {
-        sides = std::stoi(argv[1]);
-        iterations = std::stoi(argv[2]);
+    double utility(const State& state, int player) const {
+        return (player == state.winner) ? 1.0 : -1.0;
     }
 
-    LiarDieTrainer trainer(sides);
-    trainer.train(iterations);
+    bool isChance(const State& state) const {
+        return state.roll == 0 && state.winner < 0;
+    }
+
+    State sampleChance(const State& state, cfr::Philox& gen) const {
+        State next = state;
+        next.roll = 1 + gen.below(sides);
+        return next;
+    }
+
+    int player(const State& state) const {
+        return state.player;
+    }
+
+    // Claims are accepted + 1 .. sides; a claim of sides can only be doubted
+    int numActions(const State& state) const {
+        if (state.claim == 0) return sides - state.accepted;
+        return (state.claim == sides) ? 1 : 2;
+    }
+
+    uint64_t infoSetKey(const State& state) const {
+        if (state.claim == 0) return LiarDieTrainer::claimKey(state.accepted, state.roll);
+        return LiarDieTrainer::responseKey(state.accepted, state.claim);
+    }
+
+    State play(const State& state, int a) const {
+        State next = state;
+        if (state.claim == 0) {
+            next.claim = state.accepted + 1 + a;
+            next.player = 1 - state.player;
+        }
+        else if (a == DOUBT) {
+            next.winner = (state.claim > state.roll) ? state.player : 1 - state.player;
+        }
+        else {
+            next.accepted = state.claim;
+            next.claim = 0;
+            next.roll = 0;
+        }
+        return next;
+    }
+};
+
+// Train Liar Die with external-sampling MCCFR through the generic driver
+template<class Value>
+int runLiarDieMonteCarlo(const LiarDieOptions& options) {
+    cfr::ExternalSamplingTrainer<LiarDieGame, Value> trainer(LiarDieGame(options.sides));
+    double util = trainer.train(options.iterations);
+    std::cout << "Final average game value: " << util << "\n";
+    std::cout << trainer.numNodes() << " information sets, " << cfr::storageName<Value>() << " values, "
+              << trainer.memoryUsage() / 1024 << " KB\n";
+
+    if (!options.policyPath.empty() && !trainer.exportPolicy(options.policyPath, "LiarDie" + std::to_string(options.sides))) {
+        return 1;
+    }
+    return 0;
+}
+
+template<class Trainer>
+int runLiarDie(Trainer& trainer, const LiarDieOptions& options) {
+    if (options.rule == "cfr+") trainer.updateRule = Trainer::UpdateRule::CFRPlus;
+    else if (options.rule == "linear") trainer.updateRule = Trainer::UpdateRule::Linear;
+    else if (options.rule == "dcfr") trainer.updateRule = Trainer::UpdateRule::Discounted;
+    trainer.alpha = options.alpha;
+    trainer.beta = options.beta;
+    trainer.gamma = options.gamma;
+    if (!options.loadPath.empty() && !trainer.loadCheckpoint(options.loadPath)) {
+        return 1;
+    }
+    if constexpr (std::is_same_v<Trainer, BasicLiarDieTrainer<typename Trainer::Value>>) {
+        if (options.exact) {
+            trainer.trainExact(options.iterations);
+        }
+        else if (options.batchSize > 1) {
+            trainer.trainBatched(options.iterations, options.batchSize);
+        }
+        else {
+            trainer.train(options.iterations);
+        }
+    }
+    else {
+        trainer.train(options.iterations);
+    }
+    if (!options.savePath.empty() && !trainer.saveCheckpoint(options.savePath)) {
+        return 1;
+    }
+    if (!options.policyPath.empty() && !trainer.exportPolicy(options.policyPath)) {
+        return 1;
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+template<int SIDES>
+int runFixedLiarDie(const LiarDieOptions& options) {
+    // The tables are too large for the stack at higher side counts
+    auto trainer = std::make_unique<FixedLiarDieTrainer<SIDES>>();
+    return runLiarDie(*trainer, options);
+}
+
+// Train the specialized and the runtime-sides trainer from the same seed and check that they
+// reach the same exploitability. They run the same algorithm, so that checkpoints move
+// freely between them.
+template<int SIDES>
+bool checkTrainerParity(int iterations, uint64_t seed) {
+    cfr::seedGenerators(seed);
+    auto fixed = std::make_unique<FixedLiarDieTrainer<SIDES>>();
+    fixed->printSummary = false;
+    fixed->train(iterations);
+
+    cfr::seedGenerators(seed);
+    LiarDieTrainer generic(SIDES);
+    generic.printSummary = false;
+    generic.train(iterations);
+    cfr::seedGenerators(0);
+
+    double expected = fixed->exploitability();
+    double actual = generic.exploitability();
+    bool same = std::abs(expected - actual) <= 1e-9 * std::max(1.0, std::abs(expected));
+    std::cout << "LiarDie" << SIDES << " exploitability after " << iterations << " iterations: fixed "
+              << expected << ", generic " << actual << (same ? "" : "  MISMATCH") << std::endl;
+    return same;
+}
+
+// Parity of the two trainers on a few side counts, returning the exit status
+int runChecks(uint64_t seed) {
+    bool same = checkTrainerParity<3>(20000, seed);
+    same &= checkTrainerParity<6>(20000, seed);
+    same &= checkTrainerParity<20>(2000, seed);
+    return same ? 0 : 1;
+}
+
+// Micro-benchmarks of the hot paths, then the training throughput of each trainer on the
+// six-sided game, and of the exact sweep on a hundred sides, from the benchmark seed. The
+// trainer parity checks run first, and a mismatch fails the run like a regression.
+int runBenchmarks(const bench::Options& options) {
+    int status = runChecks(options.seed);
+    bench::Suite suite(options);
+
+    // Mixed-sign regrets, so regret matching takes both of its branches
+    std::mt19937 gen(options.seed);
+    std::uniform_real_distribution<double> regret(-1.0, 1.0);
+    for (int sides : {6, 100}) {
+        auto trainer = std::make_unique<LiarDieTrainer>(sides);
+        std::vector<LiarDieTrainer::Node*> claimNodes;
+        for (int oppClaim = 0; oppClaim < sides; oppClaim++) {
+            for (int roll = 1; roll <= sides; roll++) {
+                claimNodes.push_back(&trainer->claimNodes[oppClaim][roll]);
+            }
+        }
+        for (auto* node : claimNodes) {
+            for (int a = 0; a < node->numActions; a++) {
+                node->regretSum[a] = regret(gen);
+            }
+            node->pPlayer = 0.5;
+        }
+        int numNodes = claimNodes.size();
+        std::string name = "LiarDie" + std::to_string(sides);
+        suite.micro(name + ".getStrategy", 2000000, [&](long i) {
+            bench::doNotOptimize(claimNodes[i % numNodes]->getStrategy()[0]);
+        });
+        suite.micro(name + ".exploitability", sides < 10 ? 20000 : 20, [&](long) {
+            bench::doNotOptimize(trainer->exploitability());
+        });
+    }
+    suite.micro("LiarDie.claimKey", 20000000, [&](long i) {
+        bench::doNotOptimize(LiarDieTrainer::claimKey(i & 7, (i >> 3) & 7));
+    });
+
+    auto train = [](int sides, auto configure) {
+        return [sides, configure](long iterations) {
+            LiarDieTrainer trainer(sides);
+            trainer.printSummary = false;
+            configure(trainer, iterations);
+            return trainer.nodesTouched;
+        };
+    };
+    suite.macro("LiarDie6.fixed", 200000, [](long iterations) {
+        auto trainer = std::make_unique<FixedLiarDieTrainer<6>>();
+        trainer->printSummary = false;
+        trainer->train(iterations);
+        return trainer->nodesTouched;
+    });
+    suite.macro("LiarDie6.sampled", 200000, train(6, [](LiarDieTrainer& t, long n) {
+        t.train(n);
+    }));
+    suite.macro("LiarDie6.batched", 200000, train(6, [](LiarDieTrainer& t, long n) {
+        t.trainBatched(n, 16);
+    }));
+    suite.macro("LiarDie6.exact", 100000, train(6, [](LiarDieTrainer& t, long n) {
+        t.trainExact(n);
+    }));
+    suite.macro("LiarDie100.exact", 100, train(100, [](LiarDieTrainer& t, long n) {
+        t.trainExact(n);
+    }));
+    suite.macro("LiarDie6.mccfr", 100000, [](long iterations) {
+        cfr::ExternalSamplingTrainer<LiarDieGame> trainer(LiarDieGame(6));
+        trainer.train(iterations, 0);
+        return trainer.nodesTouched;
+    });
+
+    return std::max(status, suite.finish());
+}
+
+// Command line summary, printed with usage errors
+static const char* USAGE =
+    "Usage: LiarDie [sides iterations] [--rule vanilla|cfr+|linear|dcfr] [--alpha A] [--beta B] [--gamma G]\n"
+    "               [--load checkpoint] [--save checkpoint] [--export-policy table]\n"
+    "               [--batch B] [--exact] [--generic] [--float]\n"
+    "               [--mccfr] [--storage float64|float32|int32|int16] [--seed S]\n"
+    "               [--telemetry file|- [--telemetry-every seconds]]   (builds with -DCFR_TELEMETRY=1)\n"
+    "       LiarDie --check [--seed S]   (the two trainers must agree)\n"
+    "       LiarDie --bench [--baseline file] [--save-baseline file] [--tolerance percent]\n"
+    "               [--repeats R] [--bench-scale X]\n";
+
+// Report a bad command line, returning the exit status for it
+int usageError(const std::string& message) {
+    std::cerr << message << "\n" << USAGE;
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    LiarDieOptions options;
+    bench::Options benchOptions;
+    bool check = false;
+    std::vector<std::string> positional;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (bench::parseArgument(benchOptions, argc, argv, i)) {
+                continue;
+            }
+            else if (arg == "--rule" && i + 1 < argc) {
+                options.rule = argv[++i];
+                if (options.rule != "vanilla" && options.rule != "cfr+" && options.rule != "linear"
+                    && options.rule != "dcfr") {
+                    return usageError("Unknown update rule " + options.rule);
+                }
+            }
+            else if (arg == "--alpha" && i + 1 < argc) {
+                options.alpha = std::stod(argv[++i]);
+            }
+            else if (arg == "--beta" && i + 1 < argc) {
+                options.beta = std::stod(argv[++i]);
+            }
+            else if (arg == "--gamma" && i + 1 < argc) {
+                options.gamma = std::stod(argv[++i]);
+            }
+            else if (arg == "--load" && i + 1 < argc) {
+                options.loadPath = argv[++i];
+            }
+            else if (arg == "--save" && i + 1 < argc) {
+                options.savePath = argv[++i];
+            }
+            else if (arg == "--export-policy" && i + 1 < argc) {
+                options.policyPath = argv[++i];
+            }
+            else if (arg == "--batch" && i + 1 < argc) {
+                options.batchSize = std::max(1, std::stoi(argv[++i]));
+            }
+            else if (arg == "--generic") {
+                options.generic = true;
+            }
+            else if (arg == "--float") {
+                options.storage = "float32";
+            }
+            else if (arg == "--storage" && i + 1 < argc) {
+                options.storage = argv[++i];
+            }
+            else if (arg == "--exact") {
+                options.exact = true;
+            }
+            else if (arg == "--mccfr") {
+                options.monteCarlo = true;
+            }
+            else if (arg == "--check") {
+                check = true;
+            }
+            else if (arg == "--seed" && i + 1 < argc) {
+                cfr::seedGenerators(std::stoull(argv[++i]));
+            }
+            else if (arg == "--telemetry" && i + 1 < argc) {
+                options.telemetryPath = argv[++i];
+            }
+            else if (arg == "--telemetry-every" && i + 1 < argc) {
+                options.telemetryEvery = std::stod(argv[++i]);
+            }
+            else if (!arg.empty() && arg.find_first_not_of("0123456789") == std::string::npos) {
+                positional.push_back(arg);
+            }
+            else {
+                return usageError("Unknown argument " + arg);
+            }
+        }
+
+        // Take command line arguments for number of sides and iterations
+        if (positional.size() == 2) {
+            options.sides = std::stoi(positional[0]);
+            options.iterations = std::stoi(positional[1]);
+            if (options.sides <= 0) {
+                return usageError("A die needs at least one side");
+            }
+        }
+        else if (!positional.empty()) {
+            return usageError("Give both the number of sides and of iterations");
+        }
+    }
+    catch (const std::logic_error&) {
+        // A number that std::stoi and friends couldn't read
+        return usageError("Malformed number in arguments");
+    }
+
+    if (benchOptions.enabled) {
+        return runBenchmarks(benchOptions);
+    }
+    if (check) {
+        return runChecks(cfr::generatorSeed != 0 ? cfr::generatorSeed : benchOptions.seed);
+    }
+
+    if (options.storage != "float64" && options.storage != "float32"
+        && options.storage != "int32" && options.storage != "int16") {
+        std::cerr << "Unknown storage " << options.storage << "\n";
+        return 1;
+    }
+
+    if (!options.telemetryPath.empty()
+        && !telemetry::open(options.telemetryPath, "LiarDie" + std::to_string(options.sides), options.telemetryEvery)) {
+        return 1;
+    }
+
+    if (options.monteCarlo) {
+        // The generic driver has neither update rules nor checkpoints, nor the FSICFR sweeps
+        if (options.rule != "vanilla" || !options.loadPath.empty() || !options.savePath.empty()
+            || options.exact || options.batchSize > 1) {
+            std::cerr << "--mccfr can't be combined with --rule, --load, --save, --exact or --batch\n";
+            return 1;
+        }
+        if (options.storage == "float32") return runLiarDieMonteCarlo<float>(options);
+        if (options.storage == "int32") return runLiarDieMonteCarlo<cfr::Int32Value>(options);
+        if (options.storage == "int16") return runLiarDieMonteCarlo<cfr::Int16Value>(options);
+        return runLiarDieMonteCarlo<double>(options);
+    }
+
+    // Common side counts use the specialized trainer; batched and exact sweeps, reduced
+    // precision storage and other side counts fall back to the runtime-sides trainer
+    if (!options.generic && options.storage == "float64" && !options.exact && options.batchSize == 1) {
+        switch (options.sides) {
+            case 2: return runFixedLiarDie<2>(options);
+            case 3: return runFixedLiarDie<3>(options);
+            case 4: return runFixedLiarDie<4>(options);
+            case 5: return runFixedLiarDie<5>(options);
+            case 6: return runFixedLiarDie<6>(options);
+            case 8: return runFixedLiarDie<8>(options);
+            case 10: return runFixedLiarDie<10>(options);
+            case 12: return runFixedLiarDie<12>(options);
+            case 20: return runFixedLiarDie<20>(options);
+        }
+    }
+
+    if (options.storage == "float32") {
+        BasicLiarDieTrainer<float> trainer(options.sides);
+        return runLiarDie(trainer, options);
+    }
+    if (options.storage == "int32") {
+        BasicLiarDieTrainer<cfr::Int32Value> trainer(options.sides);
+        return runLiarDie(trainer, options);
+    }
+    if (options.storage == "int16") {
+        BasicLiarDieTrainer<cfr::Int16Value> trainer(options.sides);
+        return runLiarDie(trainer, options);
+    }
+    LiarDieTrainer trainer(options.sides);
+    return runLiarDie(trainer, options);
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "Checkpoint.h"
+
+// Read-only table of trained average strategies for serving, written once after training and
+// memory-mapped by the consumer. Lookups hash the information set key straight into the
+// mapped slots, so opening costs no parsing and serving an action is one probe sequence and
+// a scan of at most a node's actions.
+//
+// File layout (native byte order, every section 8-byte aligned):
+//   PolicyHeader
+//   PolicySlot slots[numSlots]        open-addressed on key, numSlots a power of two
+//   uint16_t   cumulative[numProbs]   per node, cumulative action probabilities * 65535,
+//                                     the last always 65535
+struct PolicyHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    char game[16];
+    uint64_t numNodes;
+    uint64_t numSlots;
+    uint64_t numProbs;
+};
+
+// numActions == 0 marks an empty slot
+struct PolicySlot {
+    uint64_t key;
+    uint32_t offset;
+    uint16_t numActions;
+    uint16_t unused;
+};
+
+static const char POLICY_MAGIC[8] = {'C', 'F', 'R', 'P', 'O', 'L', 'C', 'Y'};
+static const uint32_t POLICY_VERSION = 1;
+static const uint32_t POLICY_SCALE = 65535;
+
+// Home slot of key in a table of 2^slotBits slots (Fibonacci hashing)
+inline uint64_t policySlot(uint64_t key, int slotBits) {
+    return (key * 0x9E3779B97F4A7C15ULL) >> (64 - slotBits);
+}
+
+// Write a policy table from the same keys and offsets as a checkpoint. strategySum holds
+// offsets.back() values; each node's are normalized, uniform if they sum to zero.
+inline bool savePolicy(const std::string& path, const std::string& game, const std::vector<uint64_t>& keys,
+                       const std::vector<uint64_t>& offsets, const double* strategySum) {
+    // Keep the load factor at or below one half so probe sequences stay short
+    int slotBits = 1;
+    while ((1ULL << slotBits) < 2 * keys.size()) slotBits++;
+
+    PolicyHeader header = {};
+    std::memcpy(header.magic, POLICY_MAGIC, sizeof(header.magic));
+    header.version = POLICY_VERSION;
+    header.headerSize = sizeof(PolicyHeader);
+    std::strncpy(header.game, game.c_str(), sizeof(header.game) - 1);
+    header.numNodes = keys.size();
+    header.numSlots = 1ULL << slotBits;
+    header.numProbs = offsets.back();
+
+    std::vector<PolicySlot> slots(header.numSlots, PolicySlot{0, 0, 0, 0});
+    std::vector<uint16_t> cumulative(header.numProbs);
+    for (size_t i = 0; i < keys.size(); i++) {
+        uint64_t begin = offsets[i];
+        int numActions = offsets[i + 1] - begin;
+        if (numActions == 0) continue;
+
+        double normalizingSum = 0.0;
+        for (int a = 0; a < numActions; a++) {
+            normalizingSum += strategySum[begin + a];
+        }
+        double running = 0.0;
+        for (int a = 0; a < numActions; a++) {
+            running += (normalizingSum > 0) ? strategySum[begin + a] / normalizingSum : 1.0 / numActions;
+            cumulative[begin + a] = (uint16_t) std::min<double>(std::lround(running * POLICY_SCALE), POLICY_SCALE);
+        }
+        cumulative[begin + numActions - 1] = POLICY_SCALE;
+
+        uint64_t slot = policySlot(keys[i], slotBits);
+        while (slots[slot].numActions != 0) {
+            slot = (slot + 1) & (header.numSlots - 1);
+        }
+        slots[slot] = PolicySlot{keys[i], (uint32_t) begin, (uint16_t) numActions, 0};
+    }
+    // Pad the probabilities to a whole number of 8-byte words
+    cumulative.resize((cumulative.size() + 3) & ~(size_t) 3, POLICY_SCALE);
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(PolicySlot));
+    out.write(reinterpret_cast<const char*>(cumulative.data()), cumulative.size() * sizeof(uint16_t));
+    if (!out) {
+        std::cerr << "Could not write policy " << path << "\n";
+        return false;
+    }
+    std::cout << "Wrote policy " << path << ": " << keys.size() << " information sets, "
+              << (sizeof(header) + slots.size() * sizeof(PolicySlot) + cumulative.size() * sizeof(uint16_t)) / 1024
+              << " KB\n";
+    return true;
+}
+
+// Memory-mapped policy table
+class PolicyTable {
+public:
+    // One node's policy: numActions cumulative probabilities, or numActions == 0 if the key
+    // is not in the table
+    struct Entry {
+        const uint16_t* cumulative = nullptr;
+        int numActions = 0;
+
+        explicit operator bool() const {
+            return numActions > 0;
+        }
+
+        double probability(int action) const {
+            uint16_t below = (action == 0) ? 0 : cumulative[action - 1];
+            return (cumulative[action] - below) / (double) POLICY_SCALE;
+        }
+
+        // Action drawn with its probability from 32 uniform random bits
+        int sample(uint32_t random) const {
+            uint32_t r = (uint32_t) (((uint64_t) random * POLICY_SCALE) >> 32);
+            int action = 0;
+            while (action < numActions - 1 && r >= cumulative[action]) action++;
+            return action;
+        }
+    };
+
+    // Map path and check that it is a policy of this version, for game unless that is empty
+    bool open(const std::string& path, const std::string& game = "") {
+        if (!file.open(path, "policy")) {
+            return false;
+        }
+        if (file.size() < sizeof(PolicyHeader)) {
+            std::cerr << "Policy " << path << " is truncated\n";
+            return false;
+        }
+        const PolicyHeader& h = header();
+        if (std::memcmp(h.magic, POLICY_MAGIC, sizeof(h.magic)) != 0
+            || h.version != POLICY_VERSION || h.headerSize != sizeof(PolicyHeader)) {
+            std::cerr << path << " is not a version " << POLICY_VERSION << " policy\n";
+            return false;
+        }
+        if (!game.empty() && std::strncmp(h.game, game.c_str(), sizeof(h.game)) != 0) {
+            std::cerr << path << " is a policy for " << h.game << ", not " << game << "\n";
+            return false;
+        }
+        // policySlot shifts by 64 - slotBits, which needs at least two slots
+        if (h.numSlots < 2 || (h.numSlots & (h.numSlots - 1)) != 0) {
+            std::cerr << "Policy " << path << " has " << h.numSlots << " slots, not a power of two of at least 2\n";
+            return false;
+        }
+        if (h.numSlots > file.size() / sizeof(PolicySlot) || h.numProbs > file.size() / sizeof(uint16_t)) {
+            std::cerr << "Policy " << path << " is truncated\n";
+            return false;
+        }
+        uint64_t expected = sizeof(PolicyHeader) + h.numSlots * sizeof(PolicySlot)
+                            + ((h.numProbs + 3) & ~3ULL) * sizeof(uint16_t);
+        if (file.size() != expected) {
+            std::cerr << "Policy " << path << " is truncated\n";
+            return false;
+        }
+        slots = reinterpret_cast<const PolicySlot*>(file.data() + sizeof(PolicyHeader));
+        cumulative = reinterpret_cast<const uint16_t*>(slots + h.numSlots);
+        mask = h.numSlots - 1;
+        slotBits = 0;
+        while ((1ULL << slotBits) < h.numSlots) slotBits++;
+        return true;
+    }
+
+    const PolicyHeader& header() const {
+        return *reinterpret_cast<const PolicyHeader*>(file.data());
+    }
+
+    // Every key in the table, in slot order
+    std::vector<uint64_t> keys() const {
+        std::vector<uint64_t> result;
+        for (uint64_t slot = 0; slot <= mask; slot++) {
+            if (slots[slot].numActions != 0) result.push_back(slots[slot].key);
+        }
+        return result;
+    }
+
+    Entry find(uint64_t key) const {
+        for (uint64_t slot = policySlot(key, slotBits); slots[slot].numActions != 0; slot = (slot + 1) & mask) {
+            if (slots[slot].key == key) {
+                return Entry{cumulative + slots[slot].offset, slots[slot].numActions};
+            }
+        }
+        return Entry{};
+    }
+
+private:
+    MappedFile file;
+    const PolicySlot* slots = nullptr;
+    const uint16_t* cumulative = nullptr;
+    uint64_t mask = 0;
+    int slotBits = 0;
+};
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+#include "Policy.h"
+
+// Look up information sets in a policy table written with --export-policy, or time random
+// lookups and samples against it as a game server would make them.
+int main(int argc, char* argv[]) {
+    std::string path;
+    std::string game;
+    std::vector<uint64_t> queries;
+    long benchQueries = 0;
+
+    // Usage: PolicyQuery table [--game tag] [--bench N] [key ...]
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--game" && i + 1 < argc) {
+            game = argv[++i];
+        }
+        else if (arg == "--bench" && i + 1 < argc) {
+            benchQueries = std::stol(argv[++i]);
+        }
+        else if (path.empty()) {
+            path = arg;
+        }
+        else {
+            queries.push_back(std::stoull(arg, nullptr, 0));
+        }
+    }
+    if (path.empty()) {
+        std::cerr << "Usage: PolicyQuery table [--game tag] [--bench N] [key ...]\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    PolicyTable table;
+    if (!table.open(path, game)) {
+        return 1;
+    }
+    std::chrono::duration<double, std::micro> openTime = std::chrono::steady_clock::now() - start;
+    const PolicyHeader& header = table.header();
+    std::cout << header.game << " policy, " << header.numNodes << " information sets in " << header.numSlots
+              << " slots, opened in " << std::fixed << std::setprecision(1) << openTime.count() << " us\n";
+
+    std::cout << std::setprecision(5);
+    for (uint64_t key : queries) {
+        PolicyTable::Entry entry = table.find(key);
+        std::cout << key << ":";
+        if (!entry) {
+            std::cout << " not in table\n";
+            continue;
+        }
+        for (int a = 0; a < entry.numActions; a++) {
+            std::cout << " " << entry.probability(a);
+        }
+        std::cout << "\n";
+    }
+
+    if (benchQueries > 0) {
+        std::vector<uint64_t> keys = table.keys();
+        if (keys.empty()) {
+            std::cout << "Policy has no information sets, skipping the lookup benchmark\n";
+            return 0;
+        }
+        std::mt19937_64 gen(12345);
+        std::shuffle(keys.begin(), keys.end(), gen);
+        // Cheap random bits for sampling so the generator doesn't dominate the timing
+        uint32_t random = 2463534242u;
+        long checksum = 0;
+
+        start = std::chrono::steady_clock::now();
+        for (long q = 0; q < benchQueries; q++) {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            checksum += table.find(keys[q % keys.size()]).sample(random);
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << benchQueries << " lookups and samples over " << keys.size() << " keys: "
+                  << std::setprecision(1) << elapsed.count() / benchQueries << " ns each (checksum "
+                  << checksum << ")\n";
+    }
+    return 0;
+}
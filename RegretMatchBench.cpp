@@ -0,0 +1,145 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cmath>
+
+#include "CFR.h"
+
+// Microbenchmark of the fused regret-matching kernel at each SIMD level this CPU supports, for
+// the 1 to 13 action node sizes of Liar Die, Dudo and Dudo3. Every call regret-matches one node
+// of a pool and accumulates the strategy into its strategySum, as getStrategy does in training.
+// The pool is small enough to stay in L1, so the timings are of the kernel rather than memory.
+
+struct NodePool {
+    int numActions;
+    int numNodes;
+    std::vector<double> regretSum;
+    std::vector<double> strategy;
+    std::vector<double> strategySum;
+
+    // Regrets are mixed in sign, and every eighth node has none positive to exercise the
+    // uniform fallback
+    NodePool(int numActions, int numNodes, std::mt19937& gen)
+        : numActions(numActions),
+          numNodes(numNodes),
+          regretSum(numActions * numNodes),
+          strategy(numActions * numNodes),
+          strategySum(numActions * numNodes, 0.0) {
+        std::uniform_real_distribution<double> regret(-1.0, 1.0);
+        for (int node = 0; node < numNodes; node++) {
+            for (int a = 0; a < numActions; a++) {
+                double r = regret(gen);
+                regretSum[node * numActions + a] = (node % 8 == 0) ? -std::abs(r) : r;
+            }
+        }
+    }
+};
+
+// Nanoseconds per kernel call over calls calls, best of repeats. level Scalar, AVX2 or AVX512
+// forces that kernel; dispatched times cfr::regretMatchAccumulate as the trainers call it.
+double timeKernel(cfr::SimdLevel level, bool dispatched, NodePool& pool, long calls, int repeats) {
+    double best = 1e300;
+    for (int r = 0; r < repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        int node = 0;
+        for (long c = 0; c < calls; c++) {
+            int offset = node * pool.numActions;
+            if (dispatched) {
+                cfr::regretMatchAccumulate(&pool.regretSum[offset], &pool.strategy[offset],
+                                           &pool.strategySum[offset], pool.numActions, 0.5);
+            }
+            else {
+                cfr::regretMatchAt(level, &pool.regretSum[offset], &pool.strategy[offset],
+                                   &pool.strategySum[offset], pool.numActions, 0.5);
+            }
+            if (++node == pool.numNodes) node = 0;
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count() / calls);
+    }
+    return best;
+}
+
+// Largest difference between the level's strategies and the scalar kernel's over the pool
+double maxDifference(cfr::SimdLevel level, NodePool& pool) {
+    double worst = 0.0;
+    std::vector<double> expected(pool.numActions), actual(pool.numActions);
+    for (int node = 0; node < pool.numNodes; node++) {
+        const double* regretSum = &pool.regretSum[node * pool.numActions];
+        cfr::regretMatchAt(cfr::SimdLevel::Scalar, regretSum, expected.data(), nullptr, pool.numActions, 0.0);
+        cfr::regretMatchAt(level, regretSum, actual.data(), nullptr, pool.numActions, 0.0);
+        for (int a = 0; a < pool.numActions; a++) {
+            worst = std::max(worst, std::abs(expected[a] - actual[a]));
+        }
+    }
+    return worst;
+}
+
+int main(int argc, char* argv[]) {
+    long calls = 2000000;
+    int repeats = 5;
+    int maxActions = 13;
+
+    // Usage: RegretMatchBench [calls per timing] [--repeats R] [--max-actions N]
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--repeats" && i + 1 < argc) {
+            repeats = std::stoi(argv[++i]);
+        }
+        else if (arg == "--max-actions" && i + 1 < argc) {
+            maxActions = std::stoi(argv[++i]);
+        }
+        else {
+            calls = std::stol(arg);
+        }
+    }
+
+    std::vector<cfr::SimdLevel> levels;
+    for (cfr::SimdLevel level : {cfr::SimdLevel::Scalar, cfr::SimdLevel::AVX2, cfr::SimdLevel::AVX512}) {
+        if (level >= cfr::simdLevel) {
+            levels.push_back(level);
+        }
+    }
+    std::cout << "Best level: " << cfr::simdLevelName(cfr::simdLevel) << "\n";
+    std::cout << "ns per call (best of " << repeats << " x " << calls << " calls), speedup over scalar,"
+              << " max difference from scalar\n";
+
+    std::cout << "Actions";
+    for (cfr::SimdLevel level : levels) {
+        std::cout << '\t' << std::setw(8) << cfr::simdLevelName(level);
+    }
+    std::cout << "\tdispatched\n";
+
+    std::mt19937 gen(12345);
+    std::cout << std::fixed;
+    // Every node size of the games, then a few of the larger claim nodes of many-sided Liar Die
+    std::vector<int> sizes;
+    for (int n = 1; n <= maxActions; n++) {
+        sizes.push_back(n);
+    }
+    for (int n : {16, 32, 64, 128}) {
+        if (n > maxActions) sizes.push_back(n);
+    }
+
+    for (int n : sizes) {
+        NodePool pool(n, 256, gen);
+        double scalar = timeKernel(cfr::SimdLevel::Scalar, false, pool, calls, repeats);
+        std::cout << n;
+        for (cfr::SimdLevel level : levels) {
+            double ns = (level == cfr::SimdLevel::Scalar) ? scalar : timeKernel(level, false, pool, calls, repeats);
+            std::cout << '\t' << std::setprecision(2) << std::setw(5) << ns << " ns";
+            if (level != cfr::SimdLevel::Scalar) {
+                std::cout << " x" << std::setprecision(2) << scalar / ns
+                          << " (" << std::scientific << std::setprecision(0) << maxDifference(level, pool)
+                          << std::fixed << ")";
+            }
+        }
+        double ns = timeKernel(cfr::simdLevel, true, pool, calls, repeats);
+        std::cout << '\t' << std::setprecision(2) << std::setw(5) << ns << " ns x" << scalar / ns
+                  << " (" << cfr::simdLevelName(cfr::simdLevelFor(n)) << ")\n";
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <iterator>
+
+// Training telemetry: counters on the hot paths (decision node visits by depth, terminal
+// evaluations, hash table lookups and misses), wall time per training phase and memory in
+// use, written as one JSON object per line every few seconds.
+//
+// It is compiled in only with -DCFR_TELEMETRY=1. Otherwise every CFR_TELEMETRY_* macro
+// expands to nothing, arguments included, so release builds carry no trace of it. The
+// counters are plain globals updated by the training thread; the threaded Dudo workers
+// aren't counted.
+#ifndef CFR_TELEMETRY
+#define CFR_TELEMETRY 0
+#endif
+
+namespace telemetry {
+
+// Parts of an iteration that wall time is charged to
+enum class Phase {
+    Sample,     // drawing chance outcomes
+    Forward,    // FSICFR forward sweep of realization weights
+    Backward,   // FSICFR backward sweep of utilities and regrets
+    Traverse,   // recursive CFR traversal
+    Update,     // discounting and rescaling of the sums
+    Reset,      // strategy sum reset
+    NUM_PHASES
+};
+
+inline const char* phaseName(Phase phase) {
+    switch (phase) {
+        case Phase::Sample: return "sample";
+        case Phase::Forward: return "forward";
+        case Phase::Backward: return "backward";
+        case Phase::Traverse: return "traverse";
+        case Phase::Update: return "update";
+        case Phase::Reset: return "reset";
+        default: return "none";
+    }
+}
+
+// Visits at depth MAX_DEPTH - 1 and below are counted together
+static const int MAX_DEPTH = 64;
+static const int NUM_PHASES = (int) Phase::NUM_PHASES;
+
+#if CFR_TELEMETRY
+
+using Clock = std::chrono::steady_clock;
+
+struct Recorder {
+    // Cumulative since open
+    uint64_t visits[MAX_DEPTH] = {};
+    uint64_t terminals = 0;
+    uint64_t lookups = 0;
+    uint64_t misses = 0;
+    double phaseSeconds[NUM_PHASES] = {};
+
+    std::ofstream file;
+    std::ostream* out = nullptr;
+    std::string program;
+    double interval = 1.0;
+
+    Clock::time_point start;
+    Clock::time_point lastEmit;
+    uint64_t lastIteration = 0;
+    // Phase being timed and when it began
+    Phase phase = Phase::Sample;
+    Clock::time_point phaseStart;
+};
+
+inline Recorder recorder;
+
+inline double seconds(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+}
+
+// Charge the time since the last mark to the current phase and start timing phase
+inline void mark(Phase phase) {
+    Clock::time_point now = Clock::now();
+    recorder.phaseSeconds[(int) recorder.phase] += seconds(recorder.phaseStart, now);
+    recorder.phase = phase;
+    recorder.phaseStart = now;
+}
+
+inline void visit(int depth, uint64_t count) {
+    recorder.visits[depth < MAX_DEPTH ? depth : MAX_DEPTH - 1] += count;
+}
+
+inline void emit(uint64_t iteration, size_t memoryBytes, bool final) {
+    Recorder& r = recorder;
+    Clock::time_point now = Clock::now();
+    r.phaseSeconds[(int) r.phase] += seconds(r.phaseStart, now);
+    r.phaseStart = now;
+
+    uint64_t totalVisits = 0;
+    int depths = 0;
+    for (int d = 0; d < MAX_DEPTH; d++) {
+        totalVisits += r.visits[d];
+        if (r.visits[d] != 0) depths = d + 1;
+    }
+    double elapsed = seconds(r.start, now);
+    double sinceLast = seconds(r.lastEmit, now);
+
+    std::ostringstream line;
+    line << "{\"program\":\"" << r.program << "\",\"final\":" << (final ? "true" : "false")
+         << ",\"elapsed\":" << elapsed << ",\"iteration\":" << iteration
+         << ",\"iterationsPerSec\":" << (sinceLast > 0 ? (iteration - r.lastIteration) / sinceLast : 0.0)
+         << ",\"nodeVisits\":" << totalVisits << ",\"visitsByDepth\":[";
+    for (int d = 0; d < depths; d++) {
+        line << (d > 0 ? "," : "") << r.visits[d];
+    }
+    line << "],\"terminalEvals\":" << r.terminals << ",\"hashLookups\":" << r.lookups
+         << ",\"hashMisses\":" << r.misses << ",\"phaseSeconds\":{";
+    bool first = true;
+    for (int p = 0; p < NUM_PHASES; p++) {
+        if (r.phaseSeconds[p] == 0) continue;
+        line << (first ? "" : ",") << "\"" << phaseName((Phase) p) << "\":" << r.phaseSeconds[p];
+        first = false;
+    }
+    line << "},\"memoryBytes\":" << memoryBytes << "}\n";
+    *r.out << line.str() << std::flush;
+
+    r.lastEmit = now;
+    r.lastIteration = iteration;
+}
+
+// End of an iteration: emit a line if interval seconds have passed since the last one.
+// memory is only called when a line is written.
+template<class Memory>
+inline void tick(uint64_t iteration, Memory memory) {
+    if (recorder.out != nullptr && seconds(recorder.lastEmit, Clock::now()) >= recorder.interval) {
+        emit(iteration, memory(), false);
+    }
+}
+
+// End of training: emit the final totals
+template<class Memory>
+inline void finish(uint64_t iteration, Memory memory) {
+    if (recorder.out != nullptr) {
+        emit(iteration, memory(), true);
+    }
+}
+
+#define CFR_TELEMETRY_VISIT(depth, count) ::telemetry::visit((depth), (count))
+#define CFR_TELEMETRY_TERMINAL(count) (::telemetry::recorder.terminals += (count))
+#define CFR_TELEMETRY_LOOKUP(miss) (::telemetry::recorder.lookups++, ::telemetry::recorder.misses += (miss))
+#define CFR_TELEMETRY_PHASE(phase) ::telemetry::mark(::telemetry::Phase::phase)
+#define CFR_TELEMETRY_TICK(iteration, memory) ::telemetry::tick((iteration), [&]() -> size_t { return (memory); })
+#define CFR_TELEMETRY_FINISH(iteration, memory) ::telemetry::finish((iteration), [&]() -> size_t { return (memory); })
+
+#else
+
+#define CFR_TELEMETRY_VISIT(depth, count) ((void) 0)
+#define CFR_TELEMETRY_TERMINAL(count) ((void) 0)
+#define CFR_TELEMETRY_LOOKUP(miss) ((void) 0)
+#define CFR_TELEMETRY_PHASE(phase) ((void) 0)
+#define CFR_TELEMETRY_TICK(iteration, memory) ((void) 0)
+#define CFR_TELEMETRY_FINISH(iteration, memory) ((void) 0)
+
+#endif
+
+// Write telemetry for program to path ("-" for stderr) every interval seconds. Fails in
+// builds without telemetry.
+inline bool open(const std::string& path, const std::string& program, double interval) {
+#if CFR_TELEMETRY
+    Recorder& r = recorder;
+    if (path == "-") {
+        r.out = &std::cerr;
+    }
+    else {
+        r.file.open(path);
+        if (!r.file) {
+            std::cerr << "Could not write telemetry " << path << "\n";
+            return false;
+        }
+        r.out = &r.file;
+    }
+    r.program = program;
+    r.interval = interval;
+    std::fill(std::begin(r.visits), std::end(r.visits), 0);
+    std::fill(std::begin(r.phaseSeconds), std::end(r.phaseSeconds), 0.0);
+    r.terminals = r.lookups = r.misses = 0;
+    r.start = r.lastEmit = r.phaseStart = Clock::now();
+    r.lastIteration = 0;
+    return true;
+#else
+    (void) path;
+    (void) program;
+    (void) interval;
+    std::cerr << "Telemetry needs a build with -DCFR_TELEMETRY=1\n";
+    return false;
+#endif
+}
+
+}